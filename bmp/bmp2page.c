@@ -0,0 +1,247 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Asset compiler for the SSD1306/SH1106 display layout.
+ *
+ *   bmp2page <out.h> <file.bmp>...    convert 1-bit BMP images into bitmap_t
+ *   bmp2page --font <out.h>           convert the 16x26 font (font_16x26.h)
+ *
+ * The output is page-major: (height+7)/8 pages of width column bytes, bit 0
+ * is the top pixel of the page. Unused bits of the last page are zero, so the
+ * data can be ORed into the display buffer as is and is also the mask for
+ * clearing the image with AND-NOT. The image name is the file name without
+ * extension.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "font_16x26.h"
+
+#define FONT_WIDTH      16
+#define FONT_HEIGHT     26
+#define FONT_CHARS      (sizeof(font_16x26_rows) / sizeof(font_16x26_rows[0]) / FONT_HEIGHT)
+#define IMG_MAX_SIZE    255
+#define BYTES_PER_LINE  12
+
+typedef struct {
+    uint8_t width;
+    uint8_t height;
+    uint8_t pixels[IMG_MAX_SIZE][IMG_MAX_SIZE];
+} image_t;
+
+static image_t image;
+
+static const char header[] =
+"/*\n"
+" * This file is part of the WMouse distribution https://github.com/railbox/WMouse.\n"
+" * Copyright (c) 2020 Anton Nadezhdin.\n"
+" *\n"
+" * This program is free software: you can redistribute it and/or modify\n"
+" * it under the terms of the GNU General Public License as published by\n"
+" * the Free Software Foundation, version 3.\n"
+" *\n"
+" * This program is distributed in the hope that it will be useful, but\n"
+" * WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+" * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU\n"
+" * General Public License for more details.\n"
+" *\n"
+" * You should have received a copy of the GNU General Public License\n"
+" * along with this program. If not, see <http://www.gnu.org/licenses/>.\n"
+" */\n"
+"/* Generated by bmp/bmp2page, do not edit */\n";
+
+static uint32_t get_le(const uint8_t *buf, uint8_t len)
+{
+    uint32_t val = 0;
+    while (len--) val = (val << 8) | buf[len];
+    return val;
+}
+
+/* Load an uncompressed 1-bit BMP, a pixel is on when its palette colour is bright */
+static int load_bmp(const char *path, image_t *img)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+    int ret = -1;
+
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(size);
+    if (!buf || fread(buf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read error\n", path);
+        goto exit;
+    }
+    if (size < 62 || buf[0] != 'B' || buf[1] != 'M') {
+        fprintf(stderr, "%s: not a BMP file\n", path);
+        goto exit;
+    }
+
+    uint32_t offset = get_le(&buf[10], 4);
+    uint32_t info_size = get_le(&buf[14], 4);
+    int32_t width = (int32_t)get_le(&buf[18], 4);
+    int32_t height = (int32_t)get_le(&buf[22], 4);
+    uint16_t bpp = get_le(&buf[28], 2);
+    uint32_t compression = get_le(&buf[30], 4);
+    const uint8_t *palette = &buf[14 + info_size];
+    bool top_down = height < 0;
+
+    if (top_down) height = -height;
+    if (bpp != 1 || compression != 0) {
+        fprintf(stderr, "%s: only uncompressed 1-bit images are supported\n", path);
+        goto exit;
+    }
+    if (width <= 0 || height <= 0 || width > IMG_MAX_SIZE || height > IMG_MAX_SIZE) {
+        fprintf(stderr, "%s: unsupported size %dx%d\n", path, width, height);
+        goto exit;
+    }
+    uint32_t stride = ((width + 31) / 32) * 4;
+    if (offset + stride * height > (uint32_t)size || palette + 8 > buf + size) {
+        fprintf(stderr, "%s: truncated\n", path);
+        goto exit;
+    }
+
+    bool on[2];
+    for (uint8_t i=0; i<2; i++) {
+        on[i] = (palette[4*i] + palette[4*i+1] + palette[4*i+2]) >= 3*128;
+    }
+    img->width = width;
+    img->height = height;
+    for (int32_t y=0; y<height; y++) {
+        const uint8_t *line = &buf[offset + stride * (top_down ? y : height - 1 - y)];
+        for (int32_t x=0; x<width; x++) {
+            img->pixels[y][x] = on[(line[x/8] >> (7 - x%8)) & 1];
+        }
+    }
+    ret = 0;
+exit:
+    free(buf);
+    fclose(f);
+    return ret;
+}
+
+static void write_bytes(FILE *out, const uint8_t *data, size_t len, const char *end)
+{
+    for (size_t i=0; i<len; i++) {
+        bool last = (i == len - 1);
+        if (i % BYTES_PER_LINE == 0) fprintf(out, "\t");
+        fprintf(out, "0x%02X,", data[i]);
+        if (last) fprintf(out, "%s\n", end);
+        else fprintf(out, (i % BYTES_PER_LINE == BYTES_PER_LINE - 1) ? "\n" : " ");
+    }
+}
+
+/* Pack the image into pages of column bytes */
+static size_t image_to_pages(const image_t *img, uint8_t *data)
+{
+    uint8_t pages = (img->height + 7) / 8;
+    memset(data, 0, pages * img->width);
+    for (uint8_t y=0; y<img->height; y++) {
+        for (uint8_t x=0; x<img->width; x++) {
+            if (img->pixels[y][x]) data[(y/8)*img->width + x] |= 1 << (y%8);
+        }
+    }
+    return pages * img->width;
+}
+
+static int write_images(FILE *out, int count, char *files[])
+{
+    static uint8_t data[IMG_MAX_SIZE * ((IMG_MAX_SIZE + 7) / 8)];
+
+    fprintf(out, "%s", header);
+    fprintf(out,
+        "#include \"stdint.h\"\n\n"
+        "#ifndef PROGMEM\n#define PROGMEM\n#endif\n\n"
+        "/* Page-major image: (height+7)/8 pages of width column bytes, bit 0 is the\n"
+        " * top pixel of the page and unused bits of the last page are zero */\n"
+        "typedef struct {\n"
+        "\tuint8_t width;\n"
+        "\tuint8_t height;\n"
+        "\tuint8_t data[];\n"
+        "}bitmap_t;\n\n");
+
+    for (int i=0; i<count; i++) {
+        char name[64];
+        const char *base = strrchr(files[i], '/');
+        base = (base) ? base + 1 : files[i];
+        snprintf(name, sizeof(name), "%s", base);
+        char *ext = strrchr(name, '.');
+        if (ext) *ext = '\0';
+
+        if (load_bmp(files[i], &image)) return -1;
+        size_t len = image_to_pages(&image, data);
+        fprintf(out, "static bitmap_t PROGMEM %s = { %u, %u, {\n", name, image.width, image.height);
+        write_bytes(out, data, len, " }");
+        fprintf(out, "\t};\n");
+    }
+    return 0;
+}
+
+static int write_font(FILE *out)
+{
+    uint8_t data[FONT_WIDTH * ((FONT_HEIGHT + 7) / 8)];
+
+    fprintf(out, "%s", header);
+    fprintf(out,
+        "/* 16x26 font, per character (26+7)/8 pages of 16 column bytes */\n"
+        "static const uint8_t PROGMEM font_16x26_data[] = {\n");
+    image.width = FONT_WIDTH;
+    image.height = FONT_HEIGHT;
+    for (size_t ch=0; ch<FONT_CHARS; ch++) {
+        for (uint8_t y=0; y<FONT_HEIGHT; y++) {
+            uint16_t row = font_16x26_rows[ch*FONT_HEIGHT + y];
+            for (uint8_t x=0; x<FONT_WIDTH; x++) {
+                image.pixels[y][x] = (row << x) & 0x8000 ? 1 : 0;
+            }
+        }
+        size_t len = image_to_pages(&image, data);
+        fprintf(out, "\t// Ascii = [%c]\n", (char)(ch + 32));
+        write_bytes(out, data, len, "");
+    }
+    fprintf(out, "};\n");
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    bool font = (argc > 1) && !strcmp(argv[1], "--font");
+    int first = (font) ? 2 : 1;
+    FILE *out;
+    int ret;
+
+    if ((font && argc != 3) || (!font && argc < 3)) {
+        fprintf(stderr, "usage: %s <out.h> <file.bmp>...\n"
+                        "       %s --font <out.h>\n", argv[0], argv[0]);
+        return 1;
+    }
+    out = fopen(argv[first], "w");
+    if (!out) {
+        fprintf(stderr, "%s: cannot create\n", argv[first]);
+        return 1;
+    }
+    ret = (font) ? write_font(out) : write_images(out, argc - first - 1, &argv[first + 1]);
+    fclose(out);
+    if (ret) remove(argv[first]);
+    return (ret) ? 1 : 0;
+}
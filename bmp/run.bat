@@ -1,2 +0,0 @@
-for %%f in (*.bmp) do bmp2xbm.exe "%%f" "img.h" "%%~nf"
-pause
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Timing scaffolding shared by the host benchmarks. Each benchmark keeps its
+ * cases in a bench_case_t table and times them with bench_run(). */
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*bench_func_t)(uint32_t i);
+
+typedef struct {
+    const char * name;
+    bench_func_t func;
+} bench_case_t;
+
+#define BENCH_CASES_NUM(_cases)    (sizeof(_cases)/sizeof((_cases)[0]))
+
+static inline double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Calls func with i = 0..iterations-1, returns the ns per call */
+static inline double bench_run(bench_func_t func, uint32_t iterations)
+{
+    double start = bench_now_ns();
+    for (uint32_t i=0; i<iterations; i++) {
+        func(i);
+    }
+    return (bench_now_ns() - start) / iterations;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
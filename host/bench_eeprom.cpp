@@ -0,0 +1,129 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Benchmark of the EEPROM access in eeprom_hl.cpp on the host EEPROM class.
+ *
+ * Copies a whole page between a buffer and the RAM copy, one EEPROM.read()
+ * or write() per byte as the old EEPROMread/EEPROMwrite did and with the
+ * block API, then saves an unchanged page a number of times with a plain
+ * write and commit and with the compare-before-write EEPROMupdateBlock().
+ * The contents are read back through both paths and compared.
+ *
+ *   bench_eeprom [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "bench.h"
+#include "config.h"
+#include "eeprom_hl.h"
+
+#define BENCH_ITERATIONS    2000
+#define BENCH_SAVES         100
+
+static uint8_t page[2][EE_SIZE];
+static uint8_t readback[EE_SIZE];
+
+static void byte_write(uint32_t i)
+{
+    for (int a=0; a<EE_SIZE; a++) EEPROM.write(a, page[i & 1][a]);
+}
+
+static void block_write(uint32_t i)
+{
+    EEPROMwriteBlock(0, page[i & 1], EE_SIZE);
+}
+
+static void byte_read(uint32_t i)
+{
+    for (int a=0; a<EE_SIZE; a++) readback[a] = EEPROM.read(a);
+}
+
+static void block_read(uint32_t i)
+{
+    EEPROMreadBlock(0, readback, EE_SIZE);
+}
+
+static const bench_case_t bench_cases[] = {
+    {"byte_write",  byte_write},
+    {"block_write", block_write},
+    {"byte_read",   byte_read},
+    {"block_read",  block_read},
+};
+
+static uint32_t commits(void)
+{
+    host_eeprom_stats_t stats;
+    host_eeprom_get_stats(&stats);
+    return stats.commits;
+}
+
+static bool verify(const uint8_t *expected)
+{
+    for (int a=0; a<EE_SIZE; a++) {
+        if (EEPROM.read(a) != expected[a]) return false;
+    }
+    return EEPROMreadBlock(0, readback, EE_SIZE) && !memcmp(readback, expected, EE_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+    bool ok = true;
+    uint32_t start;
+
+    if (!iterations) iterations = 1;
+    srand(1);
+    for (int a=0; a<EE_SIZE; a++) {
+        page[0][a] = rand();
+        page[1][a] = ~page[0][a];
+    }
+    host_eeprom_begin(EE_SIZE);
+
+    printf("%-12s %12s\n", "case", "ns/page");
+    for (size_t c=0; c<BENCH_CASES_NUM(bench_cases); c++) {
+        printf("%-12s %12.1f\n", bench_cases[c].name, bench_run(bench_cases[c].func, iterations));
+    }
+    ok &= verify(page[(iterations - 1) & 1]);
+
+    //unchanged page saved again and again
+    EEPROMwriteBlock(0, page[0], EE_SIZE);
+    EEPROM.commit();
+    start = commits();
+    for (uint32_t i=0; i<BENCH_SAVES; i++) {
+        EEPROMwriteBlock(0, page[0], EE_SIZE);
+        EEPROM.commit();
+    }
+    printf("write_commit %u saves, %u commits\n", BENCH_SAVES, commits() - start);
+    start = commits();
+    for (uint32_t i=0; i<BENCH_SAVES; i++) {
+        ok &= EEPROMupdateBlock(0, page[0], EE_SIZE);
+    }
+    printf("update       %u saves, %u commits\n", BENCH_SAVES, commits() - start);
+    ok &= (commits() == start);
+
+    //a changed block is still written and survives a reset
+    ok &= EEPROMupdateBlock(EE_SIZE - 16, page[1], 16);
+    ok &= (commits() == start + 1);
+    memcpy(&page[0][EE_SIZE - 16], page[1], 16);
+    host_eeprom_begin(EE_SIZE);
+    ok &= verify(page[0]);
+    ok &= !EEPROMupdateBlock(EE_SIZE - 15, page[1], 16) && !EEPROMreadBlock(EE_SIZE, readback, 1);
+    printf("verify %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Rendering benchmark of the LCD layer.
+ *
+ * Draws the status icons, both fonts and the logo into the display buffer
+ * with updates deferred by lcd_begin(), so only the rendering is timed. The
+ * Makefile links it twice: bench_lcd with the byte-column blitter and
+ * bench_lcd_pixel with the per-pixel reference path (LCD_PIXEL_RENDER).
+ * Both must print the same checksum of the final panel content.
+ *
+ *   bench_lcd [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "bench.h"
+#include "lcd_hl.h"
+
+#define BENCH_ITERATIONS    20000
+
+static void bench_icons(uint32_t i)
+{
+    bool state = i & 1;
+    lcd_set_stop(state);
+    lcd_set_left(state);
+    lcd_set_pause(!state);
+    lcd_set_right(!state);
+    lcd_set_mode(true, state, false, true);
+    lcd_set_shift(true, state);
+}
+
+static void bench_main_line(uint32_t i)
+{
+    static const char * const lines[] = {"BR 218", "V 100", "ICE 3", "12345"};
+    lcd_main_print(lines[i & 3], (i & 4) ? 2 : 0, ALIGN_CENTER);
+}
+
+static void bench_bottom_line(uint32_t i)
+{
+    lcd_bottom_print((i & 1) ? "Loco speed 28 steps" : "Turnout 123 thrown", ALIGN_NONE);
+}
+
+static void bench_func_line(uint32_t i)
+{
+    lcd_set_loco_func(i % 29, true);
+}
+
+static void bench_logo(uint32_t i)
+{
+    (void)i;
+    lcd_show_logo("ver 1.0");
+}
+
+static const bench_case_t bench_cases[] = {
+    {"icons",       bench_icons},
+    {"main_line",   bench_main_line},
+    {"bottom_line", bench_bottom_line},
+    {"func_line",   bench_func_line},
+    {"logo",        bench_logo},
+};
+
+/* FNV-1a over the emulated panel pixels */
+static uint32_t panel_checksum(void)
+{
+    uint32_t hash = 2166136261u;
+    for (uint8_t y=0; y<HOST_PANEL_HEIGHT; y++) {
+        for (uint8_t x=0; x<HOST_PANEL_WIDTH; x++) {
+            hash = (hash ^ host_panel_get_pixel(x, y)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+    uint32_t checksum = 2166136261u;
+
+    if (!iterations) iterations = 1;
+    lcd_init(0x7F);
+    printf("%-12s %12s\n", "case", "ns/call");
+    for (size_t c=0; c<BENCH_CASES_NUM(bench_cases); c++) {
+        lcd_begin();
+        lcd_clear();
+        double ns = bench_run(bench_cases[c].func, iterations);
+        lcd_commit();
+        lcd_flush();
+        checksum = (checksum ^ panel_checksum()) * 16777619u;
+        printf("%-12s %12.1f\n", bench_cases[c].name, ns);
+    }
+    printf("checksum %08x\n", checksum);
+    return 0;
+}
@@ -0,0 +1,433 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Benchmark and checks of the paged loco library in loco_lib.c on the host
+ * flash region.
+ *
+ * Fills the library to its capacity, then steps through it as menu_next()
+ * and loco_next() in the choose mode do, reads it at random and looks up the
+ * addresses through the RAM index. Prints the time and the flash reads per
+ * operation. Then deletes, edits and clears entries, cuts the power at each
+ * flash operation of them and converts config_db pages of older firmware
+ * into the library, checking the entries against a copy in RAM and again
+ * after loco_lib_init() as at boot.
+ *
+ *   bench_loco [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "bench.h"
+#include "config.h"
+#include "eeprom_hl.h"
+#include "config_store.h"
+#include "config_schema.h"
+#include "loco_lib.h"
+
+#define BENCH_ITERATIONS    100000
+#define OLD_LOCOS           64      //LOCO_LIST_LEN of the older firmware
+#define REC_SIZE            16      //flash record of an entry in loco_lib.c
+
+config_db_t config_db;              //main_page.c is not linked
+
+static loco_t model[LOCO_LIB_LEN];  //what the library has to hold
+static uint16_t locos;
+
+/* config_db of the firmware before the record store, written as is at
+ * EE_CONFIG_DB */
+typedef struct {
+    char name[32];
+    uint16_t addr;
+    uint8_t ss;
+    uint32_t func;
+    int8_t speed;
+    bool dir_left;
+} loco_v0_t;
+
+typedef struct {
+    char ssid[32];
+    char pass[32];
+    uint8_t stop_mode;
+    uint8_t language_id;
+    uint8_t child_level;
+    uint16_t child_password;
+    uint8_t ipaddr[4];
+    uint8_t gwaddr[4];
+    uint8_t maskaddr[4];
+    bool dhcp;
+    uint8_t ip_z21[4];
+    uint16_t turnout_id;
+    bool turnout_state;
+    uint8_t loco_db_len;
+    uint8_t loco_db_pos;
+    loco_v0_t loco_db[OLD_LOCOS];
+    uint8_t idle_time_min;
+    bool webpage_en;
+    uint8_t contrast;
+    uint16_t magic;
+} config_db_v0_t;
+
+/* LOCO section version 1 of the record store */
+typedef struct {
+    uint8_t loco_db_len;
+    uint8_t loco_db_pos;
+    loco_t loco_db[OLD_LOCOS];
+} config_loco_v1_t;
+
+static uint16_t loco_addr(uint16_t id)
+{
+    return 1 + (uint16_t)(id * 7919u % 9999u);  //spread, not in the record order
+}
+
+static void scroll_next(uint32_t i)
+{
+    loco_t loco;
+    loco_lib_get(i % locos, &loco);
+}
+
+static void scroll_prev(uint32_t i)
+{
+    loco_t loco;
+    loco_lib_get(locos - 1 - i % locos, &loco);
+}
+
+static void random_get(uint32_t i)
+{
+    loco_t loco;
+    loco_lib_get(rand() % locos, &loco);
+}
+
+static void find(uint32_t i)
+{
+    loco_lib_find(loco_addr(i % locos));
+}
+
+static const bench_case_t bench_cases[] = {
+    {"scroll_next", scroll_next},
+    {"scroll_prev", scroll_prev},
+    {"random_get",  random_get},
+    {"find",        find},
+};
+
+static uint32_t flash_reads(void)
+{
+    host_flash_stats_t stats;
+    host_flash_get_stats(&stats);
+    return stats.reads;
+}
+
+static bool same_as(const loco_t *locos_db, uint16_t n)
+{
+    loco_t loco;
+    if (loco_lib_count() != n) return false;
+    for (uint16_t id=0; id<n; id++) {
+        if (!loco_lib_get(id, &loco) || memcmp(&loco, &locos_db[id], sizeof(loco))) return false;
+        if (loco_lib_find(loco.addr) != id) return false;
+    }
+    return true;
+}
+
+static bool same_library(void)
+{
+    return same_as(model, locos);
+}
+
+/* The library matches the model, also when read again from the flash */
+static bool check(const char *step, bool ok)
+{
+    ok = ok && same_library();
+    loco_lib_init();
+    ok = ok && same_library();
+    printf("%-20s %s\n", step, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static void model_add(const char *name, uint16_t addr, uint8_t ss)
+{
+    memset(&model[locos], 0, sizeof(loco_t));
+    memcpy(model[locos].name, name, strnlen(name, LOCO_NAME_LEN));
+    model[locos].addr = addr;
+    model[locos].ss = ss;
+    locos++;
+}
+
+static bool fill(void)
+{
+    bool ok = loco_lib_clear();
+    locos = 0;
+    while (ok && (locos < loco_lib_capacity())) {
+        char name[LOCO_NAME_LEN+1];
+        snprintf(name, sizeof(name), "L%u", loco_addr(locos));
+        model_add(name, loco_addr(locos), 2);
+        ok = loco_lib_add(&model[locos-1]);
+    }
+    return ok;
+}
+
+static bool check_edit(void)
+{
+    loco_t loco;
+    bool ok = true;
+
+    //the last entry moves into the freed place
+    ok &= loco_lib_delete(100);
+    model[100] = model[--locos];
+    ok &= check("delete_middle", ok && (loco_lib_find(loco_addr(100)) == LOCO_LIB_NONE));
+    ok &= loco_lib_delete(locos - 1);
+    locos--;
+    ok &= check("delete_last", ok);
+    ok &= loco_lib_delete(0);
+    model[0] = model[--locos];
+    ok &= check("delete_first", ok && !loco_lib_delete(locos));
+
+    //the index follows an address change, an address is only kept once
+    loco = model[5];
+    loco.addr = 10000;
+    strcpy(loco.name, "EDIT");
+    ok &= loco_lib_set(5, &loco);
+    ok &= (loco_lib_find(model[5].addr) == LOCO_LIB_NONE);
+    model[5] = loco;
+    loco.addr = model[7].addr;
+    ok &= !loco_lib_set(6, &loco);
+    ok &= !loco_lib_add(&model[8]);
+    ok &= check("set_addr", ok);
+
+    ok &= loco_lib_clear();
+    locos = 0;
+    ok &= check("clear", ok);
+    model_add("DEFLT", 3, 2);
+    ok &= check("add_after_clear", ok && loco_lib_add(&model[0]));
+    return ok;
+}
+
+/* Operations cut off by a power loss */
+static uint16_t cut_id;
+static loco_t cut_loco;
+
+static bool cut_delete(void)
+{
+    return loco_lib_delete(cut_id);
+}
+
+static bool cut_set(void)
+{
+    return loco_lib_set(cut_id, &cut_loco);
+}
+
+static bool cut_add(void)
+{
+    return loco_lib_add(&cut_loco);
+}
+
+/* Cut the power at each flash operation of op in turn. The model holds the
+ * entries after op, at the next boot the library has them or those before. */
+static bool check_cut(const char *step, bool (*op)(void), const loco_t *before, uint16_t before_len)
+{
+    static uint8_t image[HOST_FLASH_SIZE];
+    bool ok = true, done = false;
+    uint32_t cut;
+
+    memcpy(image, host_flash_image(), sizeof(image));
+    for (cut=0; ok && !done; cut++) {
+        memcpy(host_flash_image(), image, sizeof(image));
+        loco_lib_init();
+        host_flash_cut(cut);
+        done = op();
+        host_flash_cut(HOST_FLASH_POWERED);
+        loco_lib_init();
+        ok = same_library() || (!done && same_as(before, before_len));
+    }
+    printf("%-20s %u cuts\n", step, cut - 1);
+    return check(step, ok);
+}
+
+static bool check_power_cut(void)
+{
+    static loco_t before[LOCO_LIB_LEN];
+    uint16_t before_len;
+    bool ok = fill();
+
+    //delete in another sector than the last entry, then the last one
+    memcpy(before, model, sizeof(model));
+    before_len = locos;
+    cut_id = 100;
+    model[100] = model[--locos];
+    ok &= check_cut("cut_delete", cut_delete, before, before_len);
+    memcpy(before, model, sizeof(model));
+    before_len = locos;
+    cut_id = --locos;
+    ok &= check_cut("cut_delete_last", cut_delete, before, before_len);
+
+    //edit and add over a deleted record, both rewrite a sector
+    memcpy(before, model, sizeof(model));
+    before_len = locos;
+    cut_id = 300;
+    cut_loco = model[300];
+    cut_loco.addr = 10000;
+    model[300] = cut_loco;
+    ok &= check_cut("cut_set", cut_set, before, before_len);
+    memcpy(before, model, sizeof(model));
+    before_len = locos;
+    model_add("CUT", 10001, 1);
+    cut_loco = model[locos - 1];
+    ok &= check_cut("cut_add", cut_add, before, before_len);
+
+    //a damaged record is dropped, the last entry takes its place
+    host_flash_image()[50 * REC_SIZE + 2] ^= 0x01;
+    loco_lib_init();
+    model[50] = model[--locos];
+    ok &= check("damaged_record", ok);
+    return ok;
+}
+
+static void write_page(const void *data, uint16_t len)
+{
+    static uint8_t page[EE_SIZE];
+    memset(page, 0, sizeof(page));
+    memcpy(page, data, len);
+    EEPROMwriteBlock(0, page, EE_SIZE);
+    EEPROMcommitPage();
+}
+
+/* Boot with the page as written by the older firmware, then again from the
+ * converted store. keep: the page can not be converted and stays as it is. */
+static bool load(bool keep)
+{
+    config_flags_t missing;
+
+    memset(&config_db, 0, sizeof(config_db));
+    host_eeprom_begin(EE_SIZE);
+    loco_lib_init();
+    missing = config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage);
+    if (keep) return (missing & CONFIG_SCHEMA_KEEP) != 0;
+    if (missing) return false;
+    if (config_store_compact_pending()) config_store_compact();
+    memset(&config_db, 0, sizeof(config_db));
+    host_eeprom_begin(EE_SIZE);
+    loco_lib_init();
+    return !config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage);
+}
+
+static void make_v0(config_db_v0_t *db)
+{
+    static const char * const names[] = {"BR218", "V100", "LONG NAME OF A LOCO", "ICE3", "COPY"};
+    static const uint16_t addrs[] = {218, 100, 3, 403, 100};
+
+    memset(db, 0, sizeof(*db));
+    strcpy(db->ssid, "bench");
+    db->contrast = 77;
+    db->turnout_id = 12;
+    db->loco_db_len = 5;
+    db->loco_db_pos = 2;
+    for (uint8_t i=0; i<db->loco_db_len; i++) {
+        strcpy(db->loco_db[i].name, names[i]);
+        db->loco_db[i].addr = addrs[i];
+        db->loco_db[i].ss = i % 3;
+        db->loco_db[i].speed = 10;
+    }
+    db->magic = MAGIC_VALUE;
+    locos = 0;
+    for (uint8_t i=0; i<4; i++) model_add(names[i], addrs[i], i % 3);   //the copied address is skipped
+}
+
+static bool check_migration(void)
+{
+    static config_db_v0_t v0;
+    static config_loco_v1_t v1;
+    bool ok = true;
+
+    //baseline page, config_db as is
+    make_v0(&v0);
+    write_page(&v0, sizeof(v0));
+    ok &= loco_lib_clear();
+    ok &= load(false);
+    ok &= check("migrate_v0", ok && !strcmp(config_db.ssid, "bench") && (config_db.contrast == 77) &&
+                (config_db.turnout_id == 12) && (config_db.loco_db_pos == 2));
+
+    //record store with the LOCO section of version 1
+    {
+        const config_store_section_t sections[] = {
+            {CONFIG_TAG_WIFI, CONFIG_VER_WIFI, CONFIG_LEN_WIFI, &config_db.ssid, NULL},
+            {CONFIG_TAG_CONFIG, CONFIG_VER_CONFIG, CONFIG_LEN_CONFIG, &config_db.stop_mode, NULL},
+            {CONFIG_TAG_LOCO, 1, sizeof(v1), &v1, NULL},
+        };
+        memset(&v1, 0, sizeof(v1));
+        v1.loco_db_len = locos;
+        v1.loco_db_pos = 1;
+        memcpy(v1.loco_db, model, locos * sizeof(loco_t));
+        config_store_init(EEPROMimage(), EE_SIZE, sections, 3, EEPROMprogram, EEPROMcommitPage);
+        config_store_compact();
+    }
+    ok &= loco_lib_clear();
+    ok &= load(false);
+    ok &= check("migrate_v1", ok && !strcmp(config_db.ssid, "bench") && (config_db.loco_db_pos == 1));
+
+    //no room for the old locos: they are kept read-only, the page as it was
+    make_v0(&v0);
+    write_page(&v0, sizeof(v0));
+    ok &= fill();
+    ok &= load(true);
+    {
+        loco_t loco = {0};
+        uint16_t id = loco_lib_find(403);
+        ok &= loco_lib_read_only() && (loco_lib_count() == 4) && (config_db.loco_db_pos == 2);
+        ok &= (id != LOCO_LIB_NONE) && loco_lib_get(id, &loco) && !strcmp(loco.name, "ICE3");
+        ok &= !loco_lib_add(&loco) && !loco_lib_delete(id) && !loco_lib_clear();
+    }
+    //the flash region is untouched, it is read again by the next init
+    host_eeprom_begin(EE_SIZE);
+    loco_lib_init();
+    ok &= check("migrate_full", ok && !loco_lib_read_only() && !memcmp(EEPROMimage(), &v0, sizeof(v0)));
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+    host_flash_stats_t flash;
+    loco_lib_stats_t stats;
+    bool ok = true;
+    double begin;
+
+    if (!iterations) iterations = 1;
+    srand(1);
+    host_eeprom_begin(EE_SIZE);
+    host_flash_begin(NULL);
+    loco_lib_init();
+    begin = bench_now_ns();
+    ok &= fill();
+    host_flash_get_stats(&flash);
+    printf("filled %u locos in %.1f us, %u sector writes, %u erases\n", locos, (bench_now_ns() - begin) / 1e3,
+           flash.writes, flash.erases);
+
+    printf("%-12s %12s %12s\n", "case", "ns/op", "reads/op");
+    for (size_t c=0; c<BENCH_CASES_NUM(bench_cases); c++) {
+        uint32_t reads = flash_reads();
+        double ns = bench_run(bench_cases[c].func, iterations);
+        printf("%-12s %12.1f %12.4f\n", bench_cases[c].name, ns, (double)(flash_reads() - reads) / iterations);
+    }
+    loco_lib_get_stats(&stats);
+    printf("cache hits=%u misses=%u\n", stats.hits, stats.misses);
+
+    ok &= check("fill", ok);
+    ok &= check_edit();
+    ok &= check_power_cut();
+    ok &= check_migration();
+    printf("verify %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,422 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Z21 receive path benchmark and fuzzer.
+ *
+ * Checks the golden vectors first: every X-Header/DB0 the client sends or
+ * receives, with the frames expected on the wire and the callbacks expected
+ * for the received messages, including truncated and broken ones. Then times
+ * the dispatch of every received message type and the encoding of the
+ * untracked commands.
+ *
+ * Replays broadcasts through z21Client_parseReceived() and reports the
+ * throughput in datagrams and LAN messages per second, then feeds randomly
+ * mutated and truncated copies of them (valid and broken XOR, broken length
+ * fields) to the parser and to the LOCO_INFO decoder. The known frames are
+ * decoded first and checked against their expected content.
+ *
+ *   bench_z21 [-n iterations] [capture]
+ *
+ * The optional capture file holds one datagram per line as hex bytes, in the
+ * format of the host script "rx" command (the "rx" prefix is optional). A
+ * datagram may hold several LAN messages, see scripts/z21_traffic.txt.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "bench.h"
+#include "config.h"
+#include "z21client.h"
+
+#define BENCH_ITERATIONS    200000
+#define DISPATCH_ITERATIONS 1000000
+#define FUZZ_ITERATIONS     1000000
+#define TRACE_LEN           256
+#define CAPTURE_MAX         256
+#define LINE_LEN            (Z21_RX_MAX_SIZE * 3 + 16)
+
+typedef struct {
+    uint16_t len;
+    uint8_t data[Z21_RX_MAX_SIZE];
+} datagram_t;
+
+typedef struct {
+    const char *name;
+    uint8_t xnet[Z21_BUF_MAX_SIZE];     //X-Header and data, XOR is appended
+    uint8_t len;
+} frame_t;
+
+typedef struct {
+    uint32_t loco_info, speed, func, control, busy, power, service;
+} counters_t;
+
+static const frame_t frames[] = {
+    {"loco 3 128 steps fwd 5, F0",    {0xEF, 0x00, 0x03, 0x04, 0x85, 0x10, 0x00, 0x00, 0x00}, 9},
+    {"loco 1234 busy, F1 F5 F13 F21", {0xEF, 0xC4, 0xD2, 0x0C, 0x10, 0x01, 0x01, 0x01, 0x01}, 9},
+    {"loco 78 multi-unit, F29 F31",   {0xEF, 0x00, 0x4E, 0x02, 0x8A, 0x40, 0x00, 0x00, 0x00, 0x05}, 10},
+    {"track power off",               {0x61, 0x00}, 2},
+    {"normal operation resumed",      {0x61, 0x01}, 2},
+    {"status changed",                {0x62, 0x22, 0x00}, 3},
+    {"emergency stop",                {0x81, 0x00}, 2},
+    {"cv result",                     {0x64, 0x14, 0x00, 0x07, 0x2A}, 5},
+};
+
+/* Expected decoding of the first three frames */
+static const z21client_loco_info_t golden[] = {
+    {3,    128, 0x85, false, false, false, 0x00000001, 0x1FFFFFFF},
+    {1234, 128, 0x10, true,  false, false, 0x00202022, 0x1FFFFFFF},
+    {78,   28,  0x8A, false, true,  false, 0xA0000000, 0xFFFFFFFF},
+};
+
+/* Golden vector: the command sent first (if any), then the received message
+ * (if any), and the trace of the frames sent and the callbacks called */
+typedef struct {
+    const char *name;
+    void (*send)(void);
+    uint8_t xnet[Z21_BUF_MAX_SIZE];     //X-Header and data, XOR is appended
+    uint8_t len;
+    bool bad_xor;
+    const char *expect;
+} vector_t;
+
+static void send_power_on(void) { z21Client_setPower(CS_NORMAL); }
+static void send_estop(void) { z21Client_setPower(CS_ESTOP); }
+static void send_power_off(void) { z21Client_setPower(CS_TRACK_OFF); }
+static void send_status(void) { z21Client_requestStatus(); }
+static void send_speed_short(void) { z21Client_setSpeed(3, 128, 0x85); }
+static void send_speed_long(void) { z21Client_setSpeed(1234, 28, 0x05); }
+static void send_speed_14(void) { z21Client_setSpeed(78, 14, 0x8A); }
+static void send_func(void) { z21Client_setLocoFunc(3, 2, 0x4); }
+static void send_trnt_on(void) { z21Client_setTrntPos(5, true, true); }
+static void send_trnt_off(void) { z21Client_setTrntPos(5, true, false); }
+static void send_pom(void) { z21Client_setPoMCV(3, 8, 42); }
+static void send_cv_read(void) { z21Client_requestReadCV(8); }
+static void send_cv_write(void) { z21Client_setCV(8, 42); }
+static void send_subscribe(void) { z21Client_subscribeLoco(3); }
+static void send_bc_flags(void) { z21Client_setBroadcastFlags(Z21_BC_ALL); }
+static void send_batch(void)
+{
+    z21Client_beginBatch();
+    z21Client_setLocoFunc(5, 0, 0x1);
+    z21Client_beginBatch();
+    z21Client_setLocoFunc(5, 1, 0x0);
+    z21Client_flushBatch();
+    z21Client_setPower(CS_ESTOP);
+    z21Client_flushBatch();
+}
+
+static const vector_t vectors[] = {
+    {"set power on",          send_power_on,    {0}, 0, false, "tx 07 00 40 00 21 81 A0;"},
+    {"set stop",              send_estop,       {0}, 0, false, "tx 06 00 40 00 80 80;"},
+    {"set power off",         send_power_off,   {0}, 0, false, "tx 07 00 40 00 21 80 A1;"},
+    {"get status",            send_status,      {0}, 0, false, "tx 07 00 40 00 21 24 05;"},
+    {"set loco 128 steps",    send_speed_short, {0}, 0, false, "tx 0A 00 40 00 E4 13 00 03 85 71;"},
+    {"set loco long 28",      send_speed_long,  {0}, 0, false, "tx 0A 00 40 00 E4 12 C4 D2 05 E5;"},
+    {"set loco 14 steps",     send_speed_14,    {0}, 0, false, "tx 0A 00 40 00 E4 10 00 4E 8A 30;"},
+    {"set loco function",     send_func,        {0}, 0, false, "tx 0A 00 40 00 E4 F8 00 03 42 5D;"},
+    {"set turnout",           send_trnt_on,     {0}, 0, false, "tx 09 00 40 00 53 00 05 89 DF;"},
+    {"release turnout",       send_trnt_off,    {0}, 0, false, "tx 09 00 40 00 53 00 05 81 D7;"},
+    {"cv pom write",          send_pom,         {0}, 0, false, "tx 0C 00 40 00 E6 30 00 03 EC 07 2A 14;"},
+    {"batch",                 send_batch,       {0}, 0, false,
+     "tx 0A 00 40 00 E4 F8 00 05 40 59 0A 00 40 00 E4 F8 00 05 01 18 06 00 40 00 80 80;"},
+    {"bc track power off",    NULL, {0x61, 0x00}, 2, false, "power 2;"},
+    {"bc track power on",     NULL, {0x61, 0x01}, 2, false, "power 0;"},
+    {"bc track short",        NULL, {0x61, 0x08}, 2, false, "power 4;"},
+    {"bc transfer error",     NULL, {0x61, 0x80}, 2, false, ""},
+    {"bc busy",               NULL, {0x61, 0x81}, 2, false, ""},
+    {"bc unknown command",    NULL, {0x61, 0x82}, 2, false, ""},
+    {"bc without db0",        NULL, {0x61}, 1, false, ""},
+    {"bc stopped",            NULL, {0x81, 0x00}, 2, false, "power 1;"},
+    {"status normal",         NULL, {0x62, 0x22, 0x00}, 3, false, "power 0;"},
+    {"status stopped",        NULL, {0x62, 0x22, 0x01}, 3, false, "power 1;"},
+    {"status track off",      NULL, {0x62, 0x22, 0x03}, 3, false, "power 2;"},
+    {"status short",          NULL, {0x62, 0x22, 0x06}, 3, false, "power 4;"},
+    {"status service mode",   NULL, {0x62, 0x22, 0x20}, 3, false, "power 8;"},
+    {"status truncated",      NULL, {0x62, 0x22}, 2, false, ""},
+    {"status bad xor",        NULL, {0x62, 0x22, 0x02}, 3, true, ""},
+    {"loco info",             NULL, {0xEF, 0x00, 0x03, 0x04, 0x85, 0x10, 0x00, 0x00, 0x00}, 9, false,
+     "info 3/128/85/0/0/0/00000001/1FFFFFFF;speed 3/128/85;func 3/1FFFFFFF/00000001;control 3/0;"},
+    {"loco info busy long",   NULL, {0xEF, 0xC4, 0xD2, 0x0C, 0x10, 0x01, 0x01, 0x01, 0x01}, 9, false,
+     "info 1234/128/10/1/0/0/00202022/1FFFFFFF;speed 1234/128/10;func 1234/1FFFFFFF/00202022;control 1234/1;"},
+    {"loco info F29-F31",     NULL, {0xEF, 0x00, 0x4E, 0x22, 0x8A, 0x60, 0x00, 0x00, 0x00, 0x05}, 10, false,
+     "info 78/28/8A/0/1/1/A0000000/FFFFFFFF;speed 78/28/8A;func 78/FFFFFFFF/A0000000;control 78/0;"},
+    {"loco info 14 steps",    NULL, {0xEF, 0x00, 0x4E, 0x00, 0x0A, 0x1F, 0x80, 0x00, 0x00}, 9, false,
+     "info 78/14/0A/0/0/0/0000101F/1FFFFFFF;speed 78/14/0A;func 78/1FFFFFFF/0000101F;control 78/0;"},
+    {"loco info truncated",   NULL, {0xEF, 0x00, 0x03, 0x04, 0x85, 0x10, 0x00, 0x00}, 8, false, ""},
+    {"loco info bad xor",     NULL, {0xEF, 0x00, 0x03, 0x04, 0x85, 0x10, 0x00, 0x00, 0x00}, 9, true, ""},
+    {"turnout info",          NULL, {0x43, 0x00, 0x05, 0x02}, 4, false, ""},
+    {"turnout info truncated",NULL, {0x43, 0x00}, 2, false, ""},
+    {"firmware version",      NULL, {0xF3, 0x0A, 0x01, 0x40}, 4, false, ""},
+    {"cv result unrequested", NULL, {0x64, 0x14, 0x00, 0x07, 0x2A}, 5, false, ""},
+    {"cv read result",        send_cv_read, {0x64, 0x14, 0x00, 0x07, 0x2A}, 5, false,
+     "tx 09 00 40 00 23 11 00 07 35;service 1/8/42;"},
+    {"cv read truncated",     send_cv_read, {0x64, 0x14, 0x00, 0x07}, 4, false, "tx 09 00 40 00 23 11 00 07 35;"},
+    {"cv nack",               NULL, {0x61, 0x13}, 2, false, "error;"},
+    {"cv nack unrequested",   NULL, {0x61, 0x13}, 2, false, ""},
+    {"cv short circuit",      send_cv_read, {0x61, 0x12}, 2, false, "tx 09 00 40 00 23 11 00 07 35;error;"},
+    {"bc service mode",       NULL, {0x61, 0x02}, 2, false, "power 8;"},
+    {"cv write result",       send_cv_write, {0x64, 0x14, 0x00, 0x07, 0x2A}, 5, false,
+     "tx 0A 00 40 00 24 12 00 07 2A 1B;service 1/8/42;tx 07 00 40 00 21 81 A0;"},
+    {"subscribe loco",        send_subscribe,   {0}, 0, false, "tx 09 00 40 00 E3 F0 00 03 10;"},
+    {"subscribe same loco",   send_subscribe,   {0}, 0, false, ""},
+    {"broadcast flags",       send_bc_flags,    {0}, 0, false,
+     "tx 08 00 50 00 01 00 00 00 04 00 51 00 09 00 40 00 E3 F0 00 03 10;"},
+};
+
+static datagram_t capture[CAPTURE_MAX];
+static uint16_t capture_len;
+static counters_t counters;
+static bool tracing;
+static char trace[TRACE_LEN];
+
+#define TRACE(...)  do { if (tracing) snprintf(trace + strlen(trace), TRACE_LEN - strlen(trace), __VA_ARGS__); } while (0)
+
+static void notifyLocoInfo(const z21client_loco_info_t *info)
+{
+    counters.loco_info++;
+    TRACE("info %u/%u/%02X/%u/%u/%u/%08X/%08X;", info->addr, info->steps, info->speed, info->busy,
+          info->multi_unit, info->smart_search, info->func, info->func_mask);
+}
+static void notifyControl(uint16_t addr, bool busy) { counters.control++; counters.busy += busy; TRACE("control %u/%u;", addr, busy); }
+static void notifySpeed(uint16_t addr, uint8_t steps, uint8_t value) { counters.speed++; TRACE("speed %u/%u/%02X;", addr, steps, value); }
+static void notifyFunc(uint16_t addr, uint32_t mask, uint32_t state) { counters.func++; TRACE("func %u/%08X/%08X;", addr, mask, state); }
+static void notifyPower(uint8_t status) { counters.power++; TRACE("power %u;", status); }
+static void notifyService(bool direct, uint16_t cv, uint8_t value) { counters.service++; TRACE("service %u/%u/%u;", direct, cv, value); }
+static void notifyServiceError(void) { TRACE("error;"); }
+
+static const z21client_callback_t callbacks = {
+    .notifyXNetPower = notifyPower,
+    .notifyXNetLocoInfo = notifyLocoInfo,
+    .notifyXNetExtControl = notifyControl,
+    .notifyXNetExtSpeed = notifySpeed,
+    .notifyXNetExtFunc = notifyFunc,
+    .notifyXNetService = notifyService,
+    .notifyXNetServiceError = notifyServiceError,
+};
+
+static void send_data(uint8_t *data, uint16_t len)
+{
+    TRACE("tx");
+    for (uint16_t i=0; i<len; i++) TRACE(" %02X", data[i]);
+    TRACE(";");
+}
+
+static void set_xor(uint8_t *xnet, uint8_t len)
+{
+    uint8_t xor = 0;
+    for (uint8_t i=0; i<len-1; i++) xor ^= xnet[i];
+    xnet[len-1] = xor;
+}
+
+/* Append a LAN_X message to the datagram */
+static void add_message(datagram_t *dgram, const uint8_t *xnet, uint8_t xnet_len)
+{
+    uint8_t *msg = &dgram->data[dgram->len];
+    uint8_t len = LAN_HEADER_LEN + xnet_len + 1;
+
+    msg[0] = len;
+    msg[1] = 0;
+    msg[2] = LAN_X_Header;
+    msg[3] = 0;
+    memcpy(&msg[LAN_HEADER_LEN], xnet, xnet_len);
+    set_xor(&msg[LAN_HEADER_LEN], xnet_len + 1);
+    dgram->len += len;
+}
+
+static int load_capture(const char *path)
+{
+    char line[LINE_LEN];
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) && (capture_len < CAPTURE_MAX)) {
+        datagram_t *dgram = &capture[capture_len];
+        char *tok = strtok(line, " \t\r\n");
+        dgram->len = 0;
+        if (tok && !strcmp(tok, "rx")) tok = strtok(NULL, " \t\r\n");
+        for (; tok && (*tok != '#') && (dgram->len < Z21_RX_MAX_SIZE); tok = strtok(NULL, " \t\r\n")) {
+            dgram->data[dgram->len++] = strtoul(tok, NULL, 16);
+        }
+        if (dgram->len > LAN_HEADER_LEN) capture_len++;
+    }
+    fclose(f);
+    return 0;
+}
+
+static void make_vector(datagram_t *dgram, const vector_t *vector)
+{
+    dgram->len = 0;
+    add_message(dgram, vector->xnet, vector->len);
+    if (vector->bad_xor) dgram->data[dgram->len - 1] ^= 0xFF;
+}
+
+static int check_vectors(void)
+{
+    int failed = 0;
+    tracing = true;
+    for (size_t i=0; i<sizeof(vectors)/sizeof(vectors[0]); i++) {
+        const vector_t *vector = &vectors[i];
+        trace[0] = '\0';
+        if (vector->send) vector->send();
+        if (vector->len) {
+            datagram_t dgram;
+            make_vector(&dgram, vector);
+            z21Client_parseReceived(dgram.data, dgram.len);
+        }
+        if (strcmp(trace, vector->expect)) {
+            printf("vector mismatch: %s\n  expected: %s\n  got:      %s\n", vector->name, vector->expect, trace);
+            failed++;
+        }
+    }
+    tracing = false;
+    printf("golden vectors: %u/%u passed\n", (unsigned)(sizeof(vectors)/sizeof(vectors[0]) - failed),
+           (unsigned)(sizeof(vectors)/sizeof(vectors[0])));
+    return failed;
+}
+
+/* Time of one received message through the dispatch, the XOR check included */
+static void bench_dispatch(void)
+{
+    printf("%-24s ns/message\n", "message");
+    for (size_t i=0; i<sizeof(vectors)/sizeof(vectors[0]); i++) {
+        const vector_t *vector = &vectors[i];
+        datagram_t dgram;
+        if (vector->send || !vector->len) continue;
+        make_vector(&dgram, vector);
+        double start = bench_now_ns();
+        for (uint32_t n=0; n<DISPATCH_ITERATIONS; n++) z21Client_parseReceived(dgram.data, dgram.len);
+        printf("%-24s %8.1f\n", vector->name, (bench_now_ns() - start) / DISPATCH_ITERATIONS);
+    }
+}
+
+/* Time of building and handing over the untracked commands */
+static void bench_encode(void)
+{
+    static void (* const commands[])(void) = {send_status, send_power_on, send_pom};
+    static const char * const names[] = {"get status", "set power on", "cv pom write"};
+
+    printf("%-24s ns/command\n", "command");
+    for (size_t i=0; i<sizeof(commands)/sizeof(commands[0]); i++) {
+        double start = bench_now_ns();
+        for (uint32_t n=0; n<DISPATCH_ITERATIONS; n++) commands[i]();
+        printf("%-24s %8.1f\n", names[i], (bench_now_ns() - start) / DISPATCH_ITERATIONS);
+    }
+}
+
+static int check_golden(void)
+{
+    int failed = 0;
+    for (size_t i=0; i<sizeof(golden)/sizeof(golden[0]); i++) {
+        z21client_loco_info_t info;
+        uint8_t xnet[Z21_BUF_MAX_SIZE];
+        memcpy(xnet, frames[i].xnet, frames[i].len);
+        set_xor(xnet, frames[i].len + 1);
+        if (!z21Client_decodeLocoInfo(xnet, frames[i].len + 1, &info) ||
+            (info.addr != golden[i].addr) || (info.steps != golden[i].steps) ||
+            (info.speed != golden[i].speed) || (info.busy != golden[i].busy) ||
+            (info.multi_unit != golden[i].multi_unit) || (info.func != golden[i].func) ||
+            (info.func_mask != golden[i].func_mask)) {
+            printf("decode mismatch: %s\n", frames[i].name);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = BENCH_ITERATIONS;
+    int arg = 1;
+
+    if ((argc > 2) && !strcmp(argv[1], "-n")) {
+        iterations = strtoul(argv[2], NULL, 0);
+        arg = 3;
+    }
+    if (arg < argc) {
+        if (load_capture(argv[arg])) return 1;
+    } else {
+        /* Every frame alone, then all of them packed into one datagram */
+        datagram_t *burst = &capture[sizeof(frames)/sizeof(frames[0])];
+        burst->len = 0;
+        for (size_t i=0; i<sizeof(frames)/sizeof(frames[0]); i++) {
+            capture[capture_len].len = 0;
+            add_message(&capture[capture_len++], frames[i].xnet, frames[i].len);
+            add_message(burst, frames[i].xnet, frames[i].len);
+        }
+        capture_len++;
+    }
+    if (!capture_len || !iterations) {
+        fprintf(stderr, "nothing to replay\n");
+        return 1;
+    }
+    if (check_golden()) return 1;
+
+    z21Client_setSendDataCallback(send_data);
+    z21Client_setEventCallbacks(callbacks);
+    if (check_vectors()) return 1;
+    bench_dispatch();
+    bench_encode();
+    memset(&counters, 0, sizeof(counters));
+
+    /* Parsed in place, as the firmware does with the AsyncUDP packet buffer */
+    uint32_t messages = 0;
+    double start = bench_now_ns();
+    for (uint32_t i=0; i<iterations; i++) {
+        datagram_t *dgram = &capture[i % capture_len];
+        messages += z21Client_parseReceived(dgram->data, dgram->len);
+    }
+    double elapsed = bench_now_ns() - start;
+    printf("replay: %u datagrams, %u messages, %.1f ns/message, %.2f M messages/s, %.2f M datagrams/s\n",
+           iterations, messages, elapsed / messages, messages * 1e3 / elapsed, iterations * 1e3 / elapsed);
+    printf("  loco_info=%u speed=%u func=%u control=%u busy=%u power=%u\n", counters.loco_info,
+           counters.speed, counters.func, counters.control, counters.busy, counters.power);
+
+    /* Mutate the datagrams, length fields included, and cut them short. The
+     * parser gets an exact sized copy so out of bounds reads are detectable. */
+    srand(1);
+    memset(&counters, 0, sizeof(counters));
+    start = bench_now_ns();
+    for (uint32_t i=0; i<FUZZ_ITERATIONS; i++) {
+        datagram_t *src = &capture[i % capture_len];
+        uint8_t data[Z21_RX_MAX_SIZE];
+        uint16_t len = src->len;
+        uint8_t flips = 1 + rand() % 4;
+
+        memcpy(data, src->data, len);
+        while (flips--) data[rand() % len] ^= 1 << (rand() % 8);
+        if ((rand() & 1) && (data[0] > LAN_HEADER_LEN) && (data[0] <= len))
+            set_xor(&data[LAN_HEADER_LEN], data[0] - LAN_HEADER_LEN);
+        if (rand() & 1) len = rand() % (len + 1);
+
+        uint8_t *exact = malloc(len ? len : 1);
+        memcpy(exact, data, len);
+        z21client_loco_info_t info;
+        if (len > LAN_HEADER_LEN)
+            z21Client_decodeLocoInfo(&exact[LAN_HEADER_LEN], len - LAN_HEADER_LEN, &info);
+        z21Client_parseReceived(exact, len);
+        free(exact);
+    }
+    elapsed = bench_now_ns() - start;
+    printf("fuzz: %u datagrams, %.1f ns/datagram\n", FUZZ_ITERATIONS, elapsed / FUZZ_ITERATIONS);
+    printf("  loco_info=%u speed=%u func=%u control=%u busy=%u power=%u service=%u\n", counters.loco_info,
+           counters.speed, counters.func, counters.control, counters.busy, counters.power, counters.service);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOST_H
+#define HOST_H
+
+/* Host platform layer. Force-included into every translation unit of the
+ * Linux host build, so the device sources see the same Arduino services
+ * (millis(), delay()) as on the ESP8266 without being modified. */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_PANEL_WIDTH    128
+#define HOST_PANEL_HEIGHT   64
+
+typedef struct {
+    uint32_t transactions;  //I2C transactions addressed to the display
+    uint32_t bytes;         //bytes on the wire including address and control bytes
+    uint32_t data_bytes;    //display RAM bytes written
+} host_bus_stats_t;
+
+typedef struct {
+    uint32_t commits;        //sector erases by EEPROM.commit()
+    uint32_t programs;       //ESP.flashWrite() calls
+    uint32_t bytes;          //bytes written to flash by both
+    uint32_t program_errors; //programmed bytes which were not erased before
+} host_eeprom_stats_t;
+
+#define HOST_FLASH_SIZE     0x10000
+
+typedef struct {
+    uint32_t reads;          //flash_region_read() calls
+    uint32_t read_bytes;
+    uint32_t writes;         //sectors programmed
+    uint32_t erases;         //sectors erased, by a write or flash_region_erase()
+    uint32_t write_bytes;    //bytes programmed, whole sectors as on the device
+} host_flash_stats_t;
+
+/* Virtual clock */
+uint32_t millis(void);
+void delay(unsigned long ms);
+void host_timer_tick(void);
+
+/* Display emulator attached to the I2C bus stub */
+bool host_panel_get_pixel(uint8_t x, uint8_t y);
+void host_bus_get_stats(host_bus_stats_t *stats);
+
+/* Flash sector behind the EEPROM class stub. begin() reads it again as after
+ * a reset, the first call finds it erased. */
+void host_eeprom_begin(size_t size);
+void host_eeprom_get_stats(host_eeprom_stats_t *stats);
+
+/* Flash region behind flash_region.h, the FS area on the device. It is read
+ * from file and written back on every change when file is given, else it
+ * starts erased. */
+void host_flash_begin(const char *file);
+void host_flash_get_stats(host_flash_stats_t *stats);
+/* The image as is, to save and restore it between checks */
+uint8_t *host_flash_image(void);
+/* Power loss after ops more sector programs or erases: the next one leaves
+ * its sector erased and nothing is written later. HOST_FLASH_POWERED ends it. */
+#define HOST_FLASH_POWERED  0xFFFFFFFF
+void host_flash_cut(uint32_t ops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_H
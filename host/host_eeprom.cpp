@@ -0,0 +1,142 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "EEPROM.h"
+#include "Esp.h"
+#include "host.h"
+
+/* One flash sector behind the EEPROM class. Erasing sets all bits, programming
+ * can only clear them as on the device. */
+#define SECTOR_SIZE     4096
+#define FLASH_BASE      0x40200000
+
+EEPROMClass EEPROM;
+EspClass ESP;
+extern "C" {
+uint32_t _EEPROM_start;
+}
+
+static uint8_t flash[SECTOR_SIZE];
+static bool flash_ready;
+static host_eeprom_stats_t stats;
+
+static uint8_t * sector(void)
+{
+    if (!flash_ready) {
+        memset(flash, 0xFF, sizeof(flash));
+        flash_ready = true;
+    }
+    return flash;
+}
+
+bool EspClass::flashWrite(uint32_t address, const uint32_t *data, size_t size)
+{
+    uint32_t offset = address - ((uint32_t)(uintptr_t)&_EEPROM_start - FLASH_BASE);
+    const uint8_t *src = (const uint8_t*)data;
+    uint8_t *dst = sector();
+
+    if ((offset % 4) || (size % 4) || (offset > SECTOR_SIZE) || (size > SECTOR_SIZE - offset)) return false;
+    stats.programs++;
+    stats.bytes += size;
+    for (size_t i=0; i<size; i++) {
+        dst[offset+i] &= src[i];
+        if (dst[offset+i] != src[i]) stats.program_errors++;
+    }
+    return true;
+}
+
+void EEPROMClass::begin(size_t size)
+{
+    if (!size) return;
+    if (size > SECTOR_SIZE) size = SECTOR_SIZE;
+    size = (size + 3) & ~3;
+    if (_data && (size != _size)) {
+        free(_data);
+        _data = nullptr;
+    }
+    if (!_data) _data = (uint8_t*)malloc(size);
+    _size = size;
+    memcpy(_data, sector(), _size);
+    _dirty = false;
+}
+
+uint8_t EEPROMClass::read(int const address)
+{
+    if ((address < 0) || ((size_t)address >= _size) || !_data) return 0;
+    return _data[address];
+}
+
+void EEPROMClass::write(int const address, uint8_t const val)
+{
+    if ((address < 0) || ((size_t)address >= _size) || !_data) return;
+    if (_data[address] != val) {
+        _data[address] = val;
+        _dirty = true;
+    }
+}
+
+/* Erase the sector and write the whole copy, only when it is dirty */
+bool EEPROMClass::commit()
+{
+    if (!_size || !_data) return false;
+    if (!_dirty) return true;
+    memset(sector(), 0xFF, SECTOR_SIZE);
+    memcpy(sector(), _data, _size);
+    stats.commits++;
+    stats.bytes += _size;
+    _dirty = false;
+    return true;
+}
+
+bool EEPROMClass::end()
+{
+    bool ret;
+    if (!_size) return false;
+    ret = commit();
+    free(_data);
+    _data = nullptr;
+    _size = 0;
+    _dirty = false;
+    return ret;
+}
+
+uint8_t * EEPROMClass::getDataPtr()
+{
+    _dirty = true;
+    return _data;
+}
+
+uint8_t const * EEPROMClass::getConstDataPtr() const
+{
+    return _data;
+}
+
+/* Read the sector again as after a reset, changes not committed are lost */
+void host_eeprom_begin(size_t size)
+{
+    if (EEPROM.length()) {
+        free(EEPROM.getDataPtr());
+        EEPROM = EEPROMClass();
+    }
+    EEPROM.begin(size);
+}
+
+void host_eeprom_get_stats(host_eeprom_stats_t *out)
+{
+    *out = stats;
+}
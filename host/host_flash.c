@@ -0,0 +1,153 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "host.h"
+#include "flash_region.h"
+
+/* Flash region behind flash_region.h, kept in RAM and optionally in a file so
+ * the loco library outlives a run. Writes are counted per sector as the
+ * device does them, with an erase unless only erased bytes are filled. */
+static uint8_t region[HOST_FLASH_SIZE];
+static bool region_ready;
+static const char *region_file;
+static host_flash_stats_t stats;
+static uint32_t power_ops = HOST_FLASH_POWERED;
+
+static uint8_t * flash(void)
+{
+    if (!region_ready) {
+        memset(region, 0xFF, sizeof(region));
+        region_ready = true;
+    }
+    return region;
+}
+
+static void store(void)
+{
+    FILE *f;
+    if (!region_file || !(f = fopen(region_file, "wb"))) return;
+    fwrite(region, 1, sizeof(region), f);
+    fclose(f);
+}
+
+void host_flash_begin(const char *file)
+{
+    FILE *f;
+    region_file = file;
+    memset(flash(), 0xFF, sizeof(region));
+    if (file && (f = fopen(file, "rb"))) {
+        if (fread(region, 1, sizeof(region), f) != sizeof(region)) memset(region, 0xFF, sizeof(region));
+        fclose(f);
+    }
+}
+
+void host_flash_get_stats(host_flash_stats_t *out)
+{
+    *out = stats;
+}
+
+uint8_t *host_flash_image(void)
+{
+    return flash();
+}
+
+void host_flash_cut(uint32_t ops)
+{
+    power_ops = (ops == HOST_FLASH_POWERED) ? ops : ops + 1;
+}
+
+/* False for the operation at the cut, which sets cut, and all later ones */
+static bool powered(bool *cut)
+{
+    *cut = false;
+    if (power_ops == HOST_FLASH_POWERED) return true;
+    if (!power_ops) return false;
+    *cut = !--power_ops;
+    return !*cut;
+}
+
+uint32_t flash_region_size(void)
+{
+    return HOST_FLASH_SIZE;
+}
+
+bool flash_region_read(uint32_t offset, void *buf, uint32_t len)
+{
+    if ((offset > HOST_FLASH_SIZE) || (len > HOST_FLASH_SIZE - offset)) return false;
+    stats.reads++;
+    stats.read_bytes += len;
+    memcpy(buf, &flash()[offset], len);
+    return true;
+}
+
+bool flash_region_write(uint32_t offset, const void *buf, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t*)buf;
+    bool cut;
+
+    if ((offset > HOST_FLASH_SIZE) || (len > HOST_FLASH_SIZE - offset)) return false;
+    while (len) {
+        uint32_t base = offset & ~(FLASH_REGION_SECTOR - 1);
+        uint32_t pos = offset - base;
+        uint32_t part = (len < FLASH_REGION_SECTOR - pos) ? len : FLASH_REGION_SECTOR - pos;
+
+        if (memcmp(&flash()[offset], src, part)) {
+            bool erase = false;
+            for (uint32_t i=0; i<part; i++) {
+                if ((flash()[offset+i] & src[i]) != src[i]) {
+                    erase = true;
+                    break;
+                }
+            }
+            if (!powered(&cut)) {
+                //cut off after the erase or halfway through programming
+                if (cut && erase) memset(&flash()[base], 0xFF, FLASH_REGION_SECTOR);
+                else if (cut) memcpy(&flash()[offset], src, part / 2);
+                store();
+                return false;
+            }
+            stats.erases += erase;
+            stats.writes++;
+            stats.write_bytes += FLASH_REGION_SECTOR;
+            memcpy(&flash()[offset], src, part);
+        }
+        src += part;
+        offset += part;
+        len -= part;
+    }
+    store();
+    return true;
+}
+
+bool flash_region_erase(uint32_t offset, uint32_t len)
+{
+    if ((offset % FLASH_REGION_SECTOR) || (len % FLASH_REGION_SECTOR)) return false;
+    if ((offset > HOST_FLASH_SIZE) || (len > HOST_FLASH_SIZE - offset)) return false;
+    for (uint32_t base = offset; base < offset + len; base += FLASH_REGION_SECTOR) {
+        bool cut;
+        if (!powered(&cut)) {
+            if (cut) memset(&flash()[base], 0xFF, FLASH_REGION_SECTOR / 2);
+            store();
+            return false;
+        }
+        stats.erases++;
+        memset(&flash()[base], 0xFF, FLASH_REGION_SECTOR);
+    }
+    store();
+    return true;
+}
@@ -0,0 +1,501 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Linux headless host build of the WMouse UI stack.
+ *
+ * The page, menu, main page, LCD and Z21 client sources are linked against an
+ * emulated display on the I2C bus and a virtual clock. Events are read from a
+ * script file (or stdin), one command per line, '#' starts a comment:
+ *
+ *   press <button>    button pressed, button is 0-9, stop, ok, mode, next,
+ *                     prev, menu or shift
+ *   release <button>  button released
+ *   tap <button>      press, hold for TAP_TIME ms and release
+ *   wait <ms>         advance the virtual clock, timers fire as on the device
+ *   rx <hex bytes>    UDP datagram received from the command station
+ *   station on|off    answer the sent frames by the stand-in command station
+ *   station loss <%>  share of the requests and replies the station loses
+ *   station latency <ms>  station response time
+ *   station drive <addr> <speed>  another throttle sets the loco speed (RVVVVVVV)
+ *   station power on|off  track power switched on the station
+ *   station turnout <addr> <0|1>  another throttle switches the turnout (address on the wire, ID-1)
+ *   dump              print the display content
+ *   save <file>       save the display content as PBM image
+ *   reload            save, then replay the config store from the emulated flash as at boot
+ *   library <n>       append n locos to the loco library, addresses after the highest one
+ *   export            build the config web page text in chunks as the device sends it
+ *   stats             print the counters
+ *   quit              stop the script
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "host.h"
+#include "config.h"
+#include "callback.h"
+#include "buttons.h"
+#include "lcd_hl.h"
+#include "ssd1306.h"
+#include "main_page.h"
+#include "page.h"
+#include "z21client.h"
+#include "z21_station.h"
+#include "config_store.h"
+#include "config_schema.h"
+#include "eeprom_hl.h"
+#include "loco_lib.h"
+
+#define TAP_TIME        50
+#define LINE_LEN        2048
+#define BAT_HOST_LEVEL  LCD_BAT_MAX_VAL
+
+typedef struct {
+    const char * name;
+    uint8_t id;
+} button_name_t;
+
+static const button_name_t button_names[] = {
+    {"stop", STOP_BUTTON_ID},
+    {"ok", OK_BUTTON_ID},
+    {"mode", MODE_BUTTON_ID},
+    {"next", NEXT_BUTTON_ID},
+    {"prev", PREV_BUTTON_ID},
+    {"menu", MENU_BUTTON_ID},
+    {"shift", SHIFT_BUTTON_ID},
+};
+
+static callback_handler_t key_timeout_timer, powerdown_timer, status_timer, bat_timer, page_repeat_timer, store_timer;
+static bool verbose, powered_down;
+static const char *flash_file;
+static uint32_t tx_frames, rx_frames, config_saves;
+static bool config_kept;        //old config page with locos not in the library
+
+/**********************************************************************************/
+void WiFi_ResetToDefaults(void)
+{
+    strcpy(config_db.ssid, CL_SSID);
+    strcpy(config_db.pass, CL_PASS);
+    config_db.dhcp = true;
+    memcpy(config_db.ip_z21, (uint8_t[]){192, 168, 4, 111}, 4);
+}
+
+static void print_frame(const char *dir, const uint8_t *data, uint16_t len)
+{
+    printf("%8u %s", millis(), dir);
+    for (uint16_t i=0; i<len; i++) printf(" %02X", data[i]);
+    printf("\n");
+}
+
+static void SendDataToZ21(uint8_t *data, uint16_t len)
+{
+    tx_frames++;
+    if (verbose) print_frame("TX", data, len);
+    station_receive(data, len);
+}
+
+static void ReceiveFromZ21(const uint8_t *data, uint16_t len)
+{
+    rx_frames++;
+    if (verbose) print_frame("RX", data, len);
+    z21Client_parseReceived(data, len);
+}
+
+static void store_handler(void *arg)
+{
+    config_store_compact();
+}
+
+static void config_update_callback(config_flags_t flags)
+{
+    if (config_kept) return;
+    config_saves++;
+    config_store_save();
+    if (config_store_compact_pending())
+        callback_timer_start(store_timer, STORE_COMPACT_DELAY, false, store_handler, 0);
+}
+
+static void key_timeout_handler(void *arg)
+{
+    page_event_timeout();
+}
+
+static void print_stats(void);
+
+static void powerdown_handler(void *arg)
+{
+    printf("%8u powerdown\n", millis());
+    z21Client_logoff();
+    print_stats();
+    powered_down = true;
+}
+
+static void bat_handler(void * arg)
+{
+    lcd_set_battery(BAT_HOST_LEVEL, true);
+}
+
+/* Same as the firmware, the link is always up */
+static void status_handler(void * arg)
+{
+    z21Client_sessionTick(true);
+}
+
+static void powerup_handler(void * arg)
+{
+    lcd_begin();
+    lcd_clear();
+    bat_handler(NULL);
+    lcd_set_signal(LCD_SIG_MAX_VAL, true);
+    page_start(PAGE_LOCO);
+    if (config_kept) main_show_error(&err_no_fs);
+}
+
+/* Same dispatching as buttons_event() of the firmware */
+static void buttons_event(uint8_t id, bool state)
+{
+    if (id < 10) {
+        if (state) callback_timer_start(key_timeout_timer, 1000, false, key_timeout_handler, 0);
+        page_event_key(id, state);
+    } else {
+        switch (id) {
+        case STOP_BUTTON_ID:
+            page_event_back(state);
+            break;
+        case OK_BUTTON_ID:
+            if (state) callback_timer_start(powerdown_timer, 2000, false, powerdown_handler, 0);
+            else callback_timer_stop(powerdown_timer);
+            page_event_enter(state);
+            break;
+        case MODE_BUTTON_ID:
+            page_event_mode(state);
+            break;
+        case NEXT_BUTTON_ID:
+            page_event_next(state);
+            break;
+        case PREV_BUTTON_ID:
+            page_event_prev(state);
+            break;
+        case MENU_BUTTON_ID:
+            page_event_menu(state);
+            break;
+        case SHIFT_BUTTON_ID:
+            page_event_shift(state);
+            break;
+        }
+    }
+}
+
+static void setup(void)
+{
+    key_timeout_timer = callback_timer_create();
+    powerdown_timer = callback_timer_create();
+    bat_timer = callback_timer_create();
+    page_repeat_timer = callback_timer_create();
+    status_timer = callback_timer_create();
+
+    store_timer = callback_timer_create();
+
+    main_set_config_update_callback(config_update_callback);
+    host_eeprom_begin(EE_SIZE);
+    host_flash_begin(flash_file);
+    loco_lib_init();
+    config_flags_t missing = config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage);
+    if (missing & CONFIG_SCHEMA_KEEP) {
+        fprintf(stderr, "config page kept, its locos are read-only\n");
+        config_kept = true;
+        missing &= ~CONFIG_SCHEMA_KEEP;
+    }
+    if (missing) main_reset_data(missing);
+
+    lcd_init(config_db.contrast);
+    main_page_init();
+    lcd_show_logo("ver " STR(FW_MAJOR) "." STR(FW_MINOR));
+    callback_timer_start(powerdown_timer, 3000, false, powerup_handler, 0);
+    callback_timer_start(bat_timer, 10000, true, bat_handler, 0);
+
+    z21Client_setSendDataCallback(SendDataToZ21);
+    station_init(ReceiveFromZ21);
+    callback_timer_start(status_timer, Z21_STATUS_PERIOD, true, status_handler, 0);
+    callback_timer_start(page_repeat_timer, 150, true, page_repeat, 0);
+}
+
+static void loop(void)
+{
+    station_process();
+    z21Client_process(millis());
+    ssd1306_Process();
+}
+
+static void run_for(uint32_t ms)
+{
+    while (ms-- && !powered_down) {
+        host_timer_tick();
+        loop();
+    }
+}
+
+/**********************************************************************************/
+static void dump_panel(FILE *out, bool pbm)
+{
+    if (pbm) fprintf(out, "P1\n%u %u\n", HOST_PANEL_WIDTH, HOST_PANEL_HEIGHT);
+    for (uint8_t y=0; y<HOST_PANEL_HEIGHT; y++) {
+        for (uint8_t x=0; x<HOST_PANEL_WIDTH; x++) {
+            bool pixel = host_panel_get_pixel(x, y);
+            if (pbm) fputc(pixel ? '1' : '0', out);
+            else fputc(pixel ? '#' : '.', out);
+        }
+        fputc('\n', out);
+    }
+}
+
+static void print_stats(void)
+{
+    host_bus_stats_t bus;
+    ssd1306_stats_t display;
+    lcd_frame_stats_t frame;
+    host_bus_get_stats(&bus);
+    ssd1306_GetStats(&display);
+    lcd_get_frame_stats(&frame);
+    printf("time_ms=%u\n", millis());
+    printf("i2c_transactions=%u i2c_bytes=%u display_bytes=%u\n", bus.transactions, bus.bytes, bus.data_bytes);
+    printf("frames=%u frame_bytes_total=%u frame_bytes_last=%u\n", display.frames, display.bytes_total, display.bytes_last);
+    printf("display_chunks=%u display_chunk_max=%u display_saved_total=%u display_saved_last=%u\n",
+           display.chunks, display.chunk_max, display.saved_total, display.saved_last);
+    printf("lcd_requests=%u lcd_coalesced=%u fps=%u\n", frame.requests, frame.coalesced, frame.fps);
+    printf("z21_tx=%u z21_rx=%u config_saves=%u\n", tx_frames, rx_frames, config_saves);
+    config_store_stats_t store;
+    config_store_get_stats(&store);
+    printf("store_saves=%u store_skipped=%u store_records=%u store_bytes=%u store_used=%u store_migrations=%u\n",
+           store.saves, store.skipped, store.records, store.bytes, store.used, store.migrations);
+    host_eeprom_stats_t ee;
+    host_eeprom_get_stats(&ee);
+    printf("ee_erases=%u ee_program_errors=%u\n", ee.commits, ee.program_errors);
+    loco_lib_stats_t lib;
+    host_flash_stats_t fl;
+    loco_lib_get_stats(&lib);
+    host_flash_get_stats(&fl);
+    printf("lib_locos=%u lib_hits=%u lib_misses=%u lib_writes=%u lib_rewrites=%u flash_reads=%u flash_writes=%u flash_erases=%u\n",
+           loco_lib_count(), lib.hits, lib.misses, lib.writes, lib.rewrites, fl.reads, fl.writes, fl.erases);
+    for (uint8_t i=0; i<Z21_CMD_NUM; i++) {
+        static const char * const names[Z21_CMD_NUM] = {"speed", "func", "turnout", "cv"};
+        z21client_cmd_stats_t cmd;
+        z21Client_getCmdStats(i, &cmd);
+        if (!cmd.sent) continue;
+        printf("z21_%s_sent=%u coalesced=%u retries=%u acked=%u failed=%u latency_last=%u latency_max=%u latency_avg=%u\n",
+               names[i], cmd.sent, cmd.coalesced, cmd.retries, cmd.acked, cmd.failed, cmd.latency_last, cmd.latency_max,
+               cmd.acked ? cmd.latency_sum / cmd.acked : 0);
+    }
+    if (station_enabled()) {
+        station_stats_t station;
+        station_get_stats(&station);
+        printf("station_received=%u station_dropped=%u station_replies=%u station_broadcasts=%u\n",
+               station.received, station.dropped, station.replies, station.broadcasts);
+        printf("station_logoffs=%u station_timeouts=%u\n", station.logoffs, station.timeouts);
+        printf("z21_bc_flags=%08X z21_session=%u z21_poll_interval=%u z21_polls=%u\n", z21Client_getBroadcastFlags(),
+               z21Client_getSession(), z21Client_getPollInterval(), z21Client_getPollCount());
+    }
+}
+
+static int parse_button(const char *str)
+{
+    if (!str) return -1;
+    if (isdigit((unsigned char)str[0]) && !str[1]) return str[0] - '0';
+    for (uint8_t i=0; i<sizeof(button_names)/sizeof(button_names[0]); i++) {
+        if (!strcasecmp(str, button_names[i].name)) return button_names[i].id;
+    }
+    return -1;
+}
+
+static bool receive(char *args)
+{
+    uint8_t packet[Z21_RX_MAX_SIZE];
+    uint16_t len = 0;
+    char *tok;
+
+    for (tok = strtok(args, " \t"); tok; tok = strtok(NULL, " \t")) {
+        if (len >= sizeof(packet)) return false;
+        packet[len++] = strtoul(tok, NULL, 16);
+    }
+    if (len < LAN_HEADER_LEN) return false;
+    ReceiveFromZ21(packet, len);
+    return true;
+}
+
+static bool execute(char *line, uint32_t line_num)
+{
+    char *cmd, *arg, *rest;
+    int button;
+
+    cmd = strtok_r(line, " \t", &rest);
+    if (!cmd) return true;
+
+    if (!strcmp(cmd, "press") || !strcmp(cmd, "release") || !strcmp(cmd, "tap")) {
+        arg = strtok_r(NULL, " \t", &rest);
+        button = parse_button(arg);
+        if (button < 0) {
+            fprintf(stderr, "line %u: unknown button '%s'\n", line_num, arg ? arg : "");
+            return false;
+        }
+        if (cmd[0] != 'r') buttons_event(button, true);
+        if (cmd[0] == 't') run_for(TAP_TIME);
+        if (cmd[0] != 'p') buttons_event(button, false);
+    } else if (!strcmp(cmd, "wait")) {
+        arg = strtok_r(NULL, " \t", &rest);
+        if (!arg) {
+            fprintf(stderr, "line %u: wait needs a time\n", line_num);
+            return false;
+        }
+        run_for(strtoul(arg, NULL, 0));
+    } else if (!strcmp(cmd, "rx")) {
+        if (!receive(rest)) {
+            fprintf(stderr, "line %u: malformed datagram\n", line_num);
+            return false;
+        }
+    } else if (!strcmp(cmd, "station")) {
+        arg = strtok_r(NULL, " \t", &rest);
+        char *value = strtok_r(NULL, " \t", &rest);
+        if (arg && !strcmp(arg, "on")) station_enable(true);
+        else if (arg && !strcmp(arg, "off")) station_enable(false);
+        else if (arg && value && !strcmp(arg, "loss")) station_set_loss(strtoul(value, NULL, 0));
+        else if (arg && value && !strcmp(arg, "latency")) station_set_latency(strtoul(value, NULL, 0));
+        else if (arg && value && !strcmp(arg, "power")) station_power(!strcmp(value, "on"));
+        else if (arg && value && !strcmp(arg, "turnout")) {
+            char *state = strtok_r(NULL, " \t", &rest);
+            if (!state) {
+                fprintf(stderr, "line %u: station turnout needs a state\n", line_num);
+                return false;
+            }
+            station_turnout(strtoul(value, NULL, 0), strtoul(state, NULL, 0) != 0);
+        }
+        else if (arg && value && !strcmp(arg, "drive")) {
+            char *speed = strtok_r(NULL, " \t", &rest);
+            if (!speed) {
+                fprintf(stderr, "line %u: station drive needs a speed\n", line_num);
+                return false;
+            }
+            station_drive(strtoul(value, NULL, 0), strtoul(speed, NULL, 0));
+        }
+        else {
+            fprintf(stderr, "line %u: wrong station command\n", line_num);
+            return false;
+        }
+    } else if (!strcmp(cmd, "dump")) {
+        dump_panel(stdout, false);
+    } else if (!strcmp(cmd, "save")) {
+        FILE *out;
+        arg = strtok_r(NULL, " \t", &rest);
+        if (!arg || !(out = fopen(arg, "w"))) {
+            fprintf(stderr, "line %u: cannot write '%s'\n", line_num, arg ? arg : "");
+            return false;
+        }
+        dump_panel(out, true);
+        fclose(out);
+    } else if (!strcmp(cmd, "reload")) {
+        static config_db_t saved;
+        uint16_t locos = loco_lib_count();
+        config_store_save();
+        saved = config_db;
+        host_eeprom_begin(EE_SIZE);
+        loco_lib_init();
+        config_flags_t missing = config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage);
+        printf("store_reload=%s\n", missing ? "failed" : memcmp(&saved, &config_db, sizeof(saved)) ? "mismatch" : "ok");
+        printf("library_reload=%s\n", (loco_lib_count() == locos) ? "ok" : "mismatch");
+    } else if (!strcmp(cmd, "library")) {
+        uint32_t n;
+        uint16_t addr = 0;
+        loco_t loco;
+        arg = strtok_r(NULL, " \t", &rest);
+        if (!arg) {
+            fprintf(stderr, "line %u: library needs the number of locos\n", line_num);
+            return false;
+        }
+        for (uint16_t i=0; i<loco_lib_count(); i++) {
+            if (loco_lib_get(i, &loco) && (loco.addr > addr)) addr = loco.addr;
+        }
+        for (n = strtoul(arg, NULL, 0); n && (addr < 9999); n--) {
+            addr++;
+            snprintf(loco.name, sizeof(loco.name), "L%u", addr);
+            loco.addr = addr;
+            loco.ss = 2;
+            if (!loco_lib_add(&loco)) break;
+        }
+        printf("library_locos=%u\n", loco_lib_count());
+    } else if (!strcmp(cmd, "export")) {
+        char buf[256];
+        uint32_t bytes, lines = 0, chunks = 1;
+        uint16_t id = 0;
+        int len;
+        if ((len = print_config_db(buf, sizeof(buf))) < 0) {
+            fprintf(stderr, "line %u: config does not fit the export buffer\n", line_num);
+            return false;
+        }
+        bytes = len;
+        for (char *c = buf; *c; c++) lines += (*c == '\n');
+        while ((len = print_config_loco(buf, sizeof(buf), &id)) > 0) {
+            bytes += len;
+            chunks++;
+            for (char *c = buf; *c; c++) lines += (*c == '\n');
+        }
+        printf("export_bytes=%u export_lines=%u export_chunks=%u export_locos=%s\n", bytes, lines, chunks,
+               (id == loco_lib_count()) ? "ok" : "missing");
+    } else if (!strcmp(cmd, "stats")) {
+        print_stats();
+    } else if (!strcmp(cmd, "quit")) {
+        powered_down = true;
+    } else {
+        fprintf(stderr, "line %u: unknown command '%s'\n", line_num, cmd);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    char line[LINE_LEN];
+    uint32_t line_num = 0;
+    FILE *script = stdin;
+    int arg = 1;
+
+    if ((arg < argc) && !strcmp(argv[arg], "-v")) {
+        verbose = true;
+        arg++;
+    }
+    if ((arg + 1 < argc) && !strcmp(argv[arg], "-f")) {
+        flash_file = argv[arg+1];
+        arg += 2;
+    }
+    if (arg < argc) {
+        script = fopen(argv[arg], "r");
+        if (!script) {
+            fprintf(stderr, "cannot open %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    setup();
+    while (!powered_down && fgets(line, sizeof(line), script)) {
+        char *comment = strchr(line, '#');
+        line_num++;
+        if (comment) *comment = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!execute(line, line_num)) return 1;
+    }
+    if (script != stdin) fclose(script);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stddef.h>
+#include "host.h"
+#include "callback.h"
+
+#define HOST_TIMERS_NUM   32
+
+/* Ticker replacement running on the virtual clock */
+typedef struct {
+    bool used;
+    bool active;
+    bool repeat;
+    uint32_t period;
+    uint32_t due;
+    callback_funcion_t callback;
+    void * arg;
+} host_timer_t;
+
+static host_timer_t timers[HOST_TIMERS_NUM];
+static uint32_t now_ms;
+
+uint32_t millis(void)
+{
+    return now_ms;
+}
+
+void delay(unsigned long ms)
+{
+    while (ms--) host_timer_tick();
+}
+
+/* Advance the virtual clock by 1 ms and fire the timers which became due */
+void host_timer_tick(void)
+{
+    now_ms++;
+    for (uint8_t i=0; i<HOST_TIMERS_NUM; i++) {
+        host_timer_t *timer = &timers[i];
+        if (!timer->active || ((int32_t)(now_ms - timer->due) < 0)) continue;
+        if (timer->repeat) timer->due += timer->period;
+        else timer->active = false;
+        timer->callback(timer->arg);
+    }
+}
+
+//Callback implementation //////////////////////////////////////////////////////////////////////////////////////////////
+callback_handler_t callback_timer_create(void)
+{
+    for (uint8_t i=0; i<HOST_TIMERS_NUM; i++) {
+        if (!timers[i].used) {
+            timers[i].used = true;
+            return (callback_handler_t)&timers[i];
+        }
+    }
+    return NULL;
+}
+
+void callback_timer_start(callback_handler_t handler, uint32_t ms, bool repeat, callback_funcion_t callback, void * arg)
+{
+    if (!handler) return;
+    host_timer_t *timer = (host_timer_t*)handler;
+    timer->period = (ms) ? ms : 1;
+    timer->due = now_ms + timer->period;
+    timer->repeat = repeat;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->active = true;
+}
+
+void callback_timer_stop(callback_handler_t handler)
+{
+    if (!handler) return;
+    ((host_timer_t*)handler)->active = false;
+}
+
+void callback_timer_delete(callback_handler_t handler)
+{
+    if (!handler) return;
+    host_timer_t *timer = (host_timer_t*)handler;
+    timer->active = false;
+    timer->used = false;
+}
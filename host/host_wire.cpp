@@ -0,0 +1,131 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "Wire.h"
+#include "host.h"
+#include "config.h"
+#include "ssd1306.h"
+
+/* SH1106 compatible controller: 132 column RAM, page addressing mode */
+#define PANEL_RAM_WIDTH   132
+#define PANEL_PAGES       (HOST_PANEL_HEIGHT/8)
+
+TwoWire Wire;
+
+static uint8_t panel_ram[PANEL_PAGES][PANEL_RAM_WIDTH];
+static uint8_t panel_page, panel_column;
+static uint8_t pending_args;
+static host_bus_stats_t bus_stats;
+
+/* Number of argument bytes following the command byte */
+static uint8_t command_args(uint8_t command)
+{
+    switch (command) {
+    case MEMORYMODE:
+    case SETCONTRAST:
+    case SETMULTIPLEX:
+    case SETDISPLAYOFFSET:
+    case SETDISPLAYCLOCKDIV:
+    case SETPRECHARGE:
+    case SETCOMPINS:
+    case SETVCOMDETECT:
+    case DCDCCTRLMODESET:
+        return 1;
+    case COLUMNADDR:
+    case PAGEADDR:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+static void panel_command(uint8_t command)
+{
+    if (pending_args) {
+        pending_args--;
+        return;
+    }
+    if (command <= 0x0F) {
+        panel_column = (panel_column & 0xF0) | command;
+    } else if (command <= 0x1F) {
+        panel_column = (panel_column & 0x0F) | ((command & 0x0F) << 4);
+    } else if ((command & 0xF8) == PAGESTARTADDRESS) {
+        panel_page = command & 0x07;
+    } else {
+        pending_args = command_args(command);
+    }
+}
+
+static void panel_data(uint8_t data)
+{
+    if (panel_column < PANEL_RAM_WIDTH) {
+        panel_ram[panel_page][panel_column++] = data;
+    }
+    bus_stats.data_bytes++;
+}
+
+void TwoWire::begin(int sda, int scl, uint8_t address)
+{
+    (void)sda;
+    (void)scl;
+    (void)address;
+}
+
+void TwoWire::setClock(uint32_t frequency)
+{
+    (void)frequency;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _address = address;
+    _first_byte = true;
+    if (_address == OLED_I2C_ADDR) bus_stats.bytes++;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_address != OLED_I2C_ADDR) return 1;
+    bus_stats.bytes++;
+    if (_first_byte) {
+        _first_byte = false;
+        _data_mode = (data & 0x40) != 0;
+    } else if (_data_mode) {
+        panel_data(data);
+    } else {
+        panel_command(data);
+    }
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(void)
+{
+    if (_address != OLED_I2C_ADDR) return 2; //NACK on address
+    bus_stats.transactions++;
+    return 0;
+}
+
+bool host_panel_get_pixel(uint8_t x, uint8_t y)
+{
+    if ((x >= HOST_PANEL_WIDTH) || (y >= HOST_PANEL_HEIGHT)) return false;
+    return (panel_ram[y/8][x + SSD1306_XSHIFT] >> (y%8)) & 0x1;
+}
+
+void host_bus_get_stats(host_bus_stats_t *stats)
+{
+    if (stats) memcpy(stats, &bus_stats, sizeof(bus_stats));
+}
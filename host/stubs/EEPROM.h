@@ -0,0 +1,48 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+/* EEPROM class of the ESP8266 core: a RAM copy of one flash sector, read by
+ * begin() and written back as a whole by commit() when it is dirty. The flash
+ * behind it is emulated by host_eeprom.cpp. */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass
+{
+  public:
+    void begin(size_t size);
+    uint8_t read(int const address);
+    void write(int const address, uint8_t const val);
+    bool commit();
+    bool end();
+
+    uint8_t * getDataPtr();
+    uint8_t const * getConstDataPtr() const;
+    size_t length() { return _size; }
+
+  private:
+    uint8_t *_data = nullptr;
+    size_t _size = 0;
+    bool _dirty = false;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOST_ESP_H
+#define HOST_ESP_H
+
+/* Flash access of the ESP class, the EEPROM sector is emulated by
+ * host_eeprom.cpp */
+#include <stddef.h>
+#include <stdint.h>
+
+class EspClass
+{
+  public:
+    bool flashWrite(uint32_t address, const uint32_t *data, size_t size);
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress
+{
+  public:
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) : _addr{b1, b2, b3, b4} {}
+    operator const uint8_t*() const { return _addr; }
+    uint8_t operator[](int index) const { return _addr[index]; }
+    uint8_t& operator[](int index) { return _addr[index]; }
+
+  private:
+    uint8_t _addr[4];
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+/* I2C master stub. Transactions addressed to the display are decoded by the
+ * panel emulator in host_wire.cpp. */
+#include <stdint.h>
+#include <stddef.h>
+
+class TwoWire
+{
+  public:
+    void begin(int sda, int scl, uint8_t address = 0);
+    void setClock(uint32_t frequency);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(void);
+
+  private:
+    uint8_t _address;
+    bool _first_byte;
+    bool _data_mode;
+};
+
+extern TwoWire Wire;
+
+#endif
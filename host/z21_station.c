@@ -0,0 +1,345 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "host.h"
+#include "z21client.h"
+#include "z21_station.h"
+
+#define STATION_LOCOS     16
+#define STATION_CVS       1024
+#define STATION_TURNOUTS  1024
+#define STATION_QUEUE     32
+#define STATION_PKT_SIZE  24
+#define STATION_SUBSCRIBE 16    //locos the Z21 pushes LAN_X_LOCO_INFO for
+#define STATION_CLIENT_TIMEOUT 60000    //ms of silence after which the Z21 drops a client
+
+typedef struct {
+    bool used;
+    bool subscribed;
+    uint32_t subscribe_seq;
+    uint16_t addr;
+    uint8_t steps;      //DB2 speed step code of LAN_X_LOCO_INFO
+    uint8_t speed;      //RVVVVVVV
+    uint32_t func;
+} station_loco_t;
+
+typedef struct {
+    bool used;
+    uint32_t due;
+    uint8_t len;
+    uint8_t data[STATION_PKT_SIZE];
+} station_pkt_t;
+
+static station_reply_t reply_cb;
+static bool enabled;
+static uint8_t loss;
+static uint16_t latency = 10;
+static uint32_t seed = 1;
+static station_loco_t locos[STATION_LOCOS];
+static uint8_t cvs[STATION_CVS];
+static uint8_t turnouts[STATION_TURNOUTS];     //ZZ of LAN_X_TURNOUT_INFO
+static uint8_t power_state;     //DB1 of LAN_X_STATUS_CHANGED
+static uint32_t bc_flags;
+static uint32_t subscribe_seq;
+static bool client;             //the client sent something and was not dropped since
+static uint32_t client_seen;
+static station_pkt_t queue[STATION_QUEUE];
+static station_stats_t stats;
+
+/* Deterministic, so the scripts give the same result on every run */
+static bool lost(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return ((seed >> 16) % 100) < loss;
+}
+
+static station_pkt_t * queue_pkt(void)
+{
+    if (lost()) {
+        stats.dropped++;
+        return NULL;
+    }
+    for (uint8_t i=0; i<STATION_QUEUE; i++) {
+        if (!queue[i].used) {
+            queue[i].used = true;
+            queue[i].due = millis() + latency;
+            return &queue[i];
+        }
+    }
+    return NULL;
+}
+
+static void send_bc_flags(void)
+{
+    station_pkt_t *pkt = queue_pkt();
+    if (!pkt) return;
+    pkt->len = LAN_HEADER_LEN + 4;
+    pkt->data[0] = pkt->len;
+    pkt->data[1] = 0;
+    pkt->data[2] = LAN_GET_BROADCASTFLAGS;
+    pkt->data[3] = 0;
+    for (uint8_t i=0; i<4; i++) pkt->data[LAN_HEADER_LEN + i] = bc_flags >> (8*i);
+}
+
+static void send_xnet(const uint8_t *xnet, uint8_t len)
+{
+    station_pkt_t *pkt = queue_pkt();
+    uint8_t xor_sum = 0;
+
+    if (!pkt) return;
+    pkt->len = len + 1 + LAN_HEADER_LEN;
+    pkt->data[0] = pkt->len;
+    pkt->data[1] = 0;
+    pkt->data[2] = LAN_X_Header & 0xFF;
+    pkt->data[3] = LAN_X_Header >> 8;
+    memcpy(&pkt->data[LAN_HEADER_LEN], xnet, len);
+    for (uint8_t i=0; i<len; i++) xor_sum ^= xnet[i];
+    pkt->data[LAN_HEADER_LEN + len] = xor_sum;
+}
+
+static station_loco_t * get_loco(uint16_t addr)
+{
+    station_loco_t *free_loco = NULL;
+    for (uint8_t i=0; i<STATION_LOCOS; i++) {
+        if (locos[i].used && (locos[i].addr == addr)) return &locos[i];
+        if (!free_loco && !locos[i].used) free_loco = &locos[i];
+    }
+    if (!free_loco) free_loco = &locos[0];
+    memset(free_loco, 0, sizeof(*free_loco));
+    free_loco->used = true;
+    free_loco->addr = addr;
+    free_loco->steps = 4;
+    return free_loco;
+}
+
+/* Only the last STATION_SUBSCRIBE locos asked for stay subscribed */
+static void subscribe(station_loco_t *loco)
+{
+    uint8_t count = 0;
+    station_loco_t *oldest = NULL;
+
+    loco->subscribed = true;
+    loco->subscribe_seq = ++subscribe_seq;
+    for (uint8_t i=0; i<STATION_LOCOS; i++) {
+        if (!locos[i].subscribed) continue;
+        count++;
+        if (!oldest || (locos[i].subscribe_seq < oldest->subscribe_seq)) oldest = &locos[i];
+    }
+    if (count > STATION_SUBSCRIBE) oldest->subscribed = false;
+}
+
+static void send_loco_info(const station_loco_t *loco)
+{
+    uint8_t info[] = {LAN_X_LOCO_INFO, loco->addr >> 8, loco->addr & 0xFF, loco->steps, loco->speed,
+                      ((loco->func & 0x01) << 4) | ((loco->func >> 1) & 0x0F),
+                      loco->func >> 5, loco->func >> 13, loco->func >> 21, (loco->func >> 29) & 0x07};
+    if (loco->addr >= 128) info[1] |= 0xC0;
+    send_xnet(info, sizeof(info));
+}
+
+static void handle_xnet(const uint8_t *x, uint8_t len)
+{
+    switch (x[0]) {
+    case LAN_X_SET_LOCO: {
+        if (len < 5) return;
+        station_loco_t *loco = get_loco(((x[2] & 0x3F) << 8) | x[3]);
+        if (x[1] == LAN_X_SET_LOCO_FUNCTION) {
+            uint8_t num = x[4] & 0x3F;
+            uint32_t bit = (uint32_t)1 << (num & 0x1F);
+            switch (x[4] >> 6) {
+            case 0: loco->func &= ~bit; break;
+            case 1: loco->func |= bit; break;
+            case 2: loco->func ^= bit; break;
+            }
+        } else {
+            loco->steps = (x[1] == 0x10) ? 0 : (x[1] == 0x12) ? 2 : 4;
+            loco->speed = x[4];
+        }
+        send_loco_info(loco);
+        break;
+    }
+    case LAN_X_GET_LOCO_INFO: {
+        if ((len < 4) || (x[1] != 0xF0)) return;
+        station_loco_t *loco = get_loco(((x[2] & 0x3F) << 8) | x[3]);
+        subscribe(loco);
+        send_loco_info(loco);
+        break;
+    }
+    case LAN_X_SET_TURNOUT: {
+        if (len < 4) return;
+        if (!(x[3] & 0x08)) return;     //deactivation is not reported
+        uint16_t addr = ((x[1] << 8) | x[2]) % STATION_TURNOUTS;
+        turnouts[addr] = (x[3] & 0x01) ? 0x02 : 0x01;
+        uint8_t info[] = {LAN_X_TURNOUT_INFO, x[1], x[2], turnouts[addr]};
+        send_xnet(info, sizeof(info));
+        break;
+    }
+    case LAN_X_GET_TURNOUT_INFO: {
+        if (len < 3) return;
+        uint8_t info[] = {LAN_X_TURNOUT_INFO, x[1], x[2], turnouts[((x[1] << 8) | x[2]) % STATION_TURNOUTS]};
+        send_xnet(info, sizeof(info));
+        break;
+    }
+    case LAN_X_CV_READ:
+    case LAN_X_CV_WRITE: {
+        if (len < 4) return;
+        uint16_t cv = ((x[2] << 8) | x[3]) % STATION_CVS;
+        if ((x[0] == LAN_X_CV_WRITE) && (len >= 5)) cvs[cv] = x[4];
+        uint8_t result[] = {LAN_X_CV_RESULT, 0x14, x[2], x[3], cvs[cv]};
+        send_xnet(result, sizeof(result));
+        break;
+    }
+    case LAN_X_GET_STATUS:
+        if ((len >= 2) && (x[1] == 0x81)) {
+            power_state = 0x00;
+            send_xnet((uint8_t[]){0x61, 0x01}, 2);
+        } else if ((len >= 2) && (x[1] == 0x80)) {
+            power_state = 0x02;
+            send_xnet((uint8_t[]){0x61, 0x00}, 2);
+        } else {
+            send_xnet((uint8_t[]){0x62, 0x22, power_state}, 3);
+        }
+        break;
+    case 0x80:  //LAN_X_SET_STOP
+        power_state = 0x01;
+        send_xnet((uint8_t[]){0x81, 0x00}, 2);
+        break;
+    }
+}
+
+void station_init(station_reply_t reply)
+{
+    reply_cb = reply;
+    for (uint16_t i=0; i<STATION_CVS; i++) cvs[i] = 3;
+}
+
+void station_enable(bool enable)
+{
+    enabled = enable;
+}
+
+bool station_enabled(void)
+{
+    return enabled;
+}
+
+void station_set_loss(uint8_t percent)
+{
+    loss = (percent > 100) ? 100 : percent;
+}
+
+void station_set_latency(uint16_t ms)
+{
+    latency = ms;
+}
+
+/* The client logged off or went silent, its subscriptions are gone */
+static void drop_client(void)
+{
+    client = false;
+    bc_flags = 0;
+    for (uint8_t i=0; i<STATION_LOCOS; i++) locos[i].subscribed = false;
+}
+
+/* Datagram sent by the client, it may hold several LAN messages. The loss
+ * applies to the whole datagram. */
+void station_receive(const uint8_t *data, uint16_t len)
+{
+    if (!enabled || (len < LAN_HEADER_LEN)) return;
+    stats.received++;
+    if (lost()) {
+        stats.dropped++;
+        return;
+    }
+    client = true;
+    client_seen = millis();
+    while (len >= LAN_HEADER_LEN) {
+        uint16_t msg_len = data[0] | (data[1] << 8);
+        if ((msg_len < LAN_HEADER_LEN) || (msg_len > len)) break;
+        switch (data[2] | (data[3] << 8)) {
+        case LAN_X_Header:
+            handle_xnet(&data[LAN_HEADER_LEN], msg_len - LAN_HEADER_LEN);
+            break;
+        case LAN_SET_BROADCASTFLAGS:
+            if (msg_len >= LAN_HEADER_LEN + 4)
+                bc_flags = data[4] | (data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+            break;
+        case LAN_GET_BROADCASTFLAGS:
+            send_bc_flags();
+            break;
+        case LAN_LOGOFF:
+            stats.logoffs++;
+            drop_client();
+            break;
+        }
+        data += msg_len;
+        len -= msg_len;
+    }
+}
+
+/* Deliver the replies which became due, called from the host main loop */
+void station_process(void)
+{
+    if (client && ((millis() - client_seen) >= STATION_CLIENT_TIMEOUT)) {
+        stats.timeouts++;
+        drop_client();
+    }
+    for (uint8_t i=0; i<STATION_QUEUE; i++) {
+        station_pkt_t *pkt = &queue[i];
+        if (!pkt->used || ((int32_t)(millis() - pkt->due) < 0)) continue;
+        pkt->used = false;
+        stats.replies++;
+        if (reply_cb) reply_cb(pkt->data, pkt->len);
+    }
+}
+
+/* Another throttle drives the loco, pushed to the client when subscribed */
+void station_drive(uint16_t addr, uint8_t speed)
+{
+    station_loco_t *loco = get_loco(addr);
+    loco->speed = speed;
+    if (enabled && (bc_flags & Z21_BC_ALL) && loco->subscribed) {
+        stats.broadcasts++;
+        send_loco_info(loco);
+    }
+}
+
+/* Track power switched on the command station itself */
+void station_power(bool on)
+{
+    power_state = on ? 0x00 : 0x02;
+    if (enabled && (bc_flags & Z21_BC_ALL)) {
+        stats.broadcasts++;
+        send_xnet((uint8_t[]){0x61, on ? 0x01 : 0x00}, 2);
+    }
+}
+
+/* Another throttle switches the turnout, pushed to the client */
+void station_turnout(uint16_t addr, bool state)
+{
+    addr %= STATION_TURNOUTS;
+    turnouts[addr] = state ? 0x02 : 0x01;
+    if (enabled && (bc_flags & Z21_BC_ALL)) {
+        stats.broadcasts++;
+        send_xnet((uint8_t[]){LAN_X_TURNOUT_INFO, addr >> 8, addr & 0xFF, turnouts[addr]}, 4);
+    }
+}
+
+void station_get_stats(station_stats_t *out)
+{
+    *out = stats;
+}
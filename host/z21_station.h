@@ -0,0 +1,50 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef Z21_STATION_H
+#define Z21_STATION_H
+
+/* Stand-in command station for the host build. It answers the Z21 LAN frames
+ * sent by the client the way a real Z21 does, after a configurable latency and
+ * with a configurable loss rate, so the request/response handling of the
+ * client can be exercised without the hardware. */
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*station_reply_t)(const uint8_t *data, uint16_t len);
+
+typedef struct {
+    uint32_t received;      //frames received from the client
+    uint32_t dropped;       //requests and replies lost on purpose
+    uint32_t replies;       //replies delivered to the client
+    uint32_t broadcasts;    //state changes pushed to the client
+    uint32_t logoffs;       //LAN_LOGOFF received
+    uint32_t timeouts;      //client dropped after STATION_CLIENT_TIMEOUT of silence
+} station_stats_t;
+
+void station_init(station_reply_t reply);
+void station_enable(bool enable);
+bool station_enabled(void);
+void station_set_loss(uint8_t percent);
+void station_set_latency(uint16_t ms);
+void station_receive(const uint8_t *data, uint16_t len);
+void station_process(void);
+void station_drive(uint16_t addr, uint8_t speed);
+void station_power(bool on);
+void station_turnout(uint16_t addr, bool state);
+void station_get_stats(station_stats_t *stats);
+
+#endif // Z21_STATION_H
@@ -22,11 +22,13 @@
 #ifdef _WIN32
 #include <conio.h>
 #include "draw.h"
+#include "host/host.h"
 #endif
 
 #include "src/main_page.h"
 #include "src/menu_ll.h"
 #include "src/page.h"
+#include "src/loco_lib.h"
 
 #include "src/lcd_hl.h"
 
@@ -43,10 +45,14 @@ int main()
     SET_IP(config_db.ipaddr, 192,168,4,10);
     SET_IP(config_db.maskaddr, 255,255,255,0);
     SET_IP(config_db.gwaddr, 192,168,4,1);
-    config_db.loco_db_len = 1;
-    strcpy(config_db.loco_db[0].name, "DEFLT");
-    config_db.loco_db[0].addr = 3;
-    config_db.loco_db[0].ss = 2;
+#ifdef _WIN32
+    host_flash_begin("loco_lib.bin");
+#endif
+    loco_lib_init();
+    if (!loco_lib_count()) {
+        loco_t loco = {"DEFLT", 2, 3};
+        loco_lib_add(&loco);
+    }
 
 
     lcd_init(config_db.contrast);
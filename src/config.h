@@ -38,16 +38,31 @@
 #define CL_PASS           "12345678"  // Default Z21 network password
 #define IP_MEM_SIZE       20          //Client IP that are stored
 #define Z21_BUF_MAX_SIZE  24          //max UDP packet size
+#define Z21_RX_MAX_SIZE   512         //max received UDP datagram, several LAN messages
+#define Z21_TX_MAX_SIZE   256         //max sent UDP datagram, batched LAN messages
 #define Z21_PORT          21105       //Z21 UDP port
+#define Z21_STATUS_PERIOD 2000        //ms, session tick, login retry and shortest status poll interval
+#define Z21_KEEPALIVE     20000       //ms, longest status poll interval, the Z21 drops a client after 60 s
+#define Z21_TURNOUT_CACHE 1024        //turnout addresses with the position cached, 2 bits each
+#define Z21_REPLY_TIMEOUT 2000        //ms after a status poll without anything received, a missed reply
 #define UART_BAUDRATE     115200      //Default serial port baudrate
 #define LOCO_MAX_STEP     21
+#define LCD_FRAME_RATE    25          //display refresh rate limit, frames per second
 
 
 //EEPROM Configuration /////////////////////////////////////////////////////
 #define EE_SIZE           4096
-#define MAGIC_VALUE       0xAB12
+#define MAGIC_VALUE       0xAB12      //config_db image before the record store
+#define EE_STORE_MAGIC    0xC57F      //config record store, see config_store.h
 //Client:
-#define EE_CONFIG_DB      0
+#define EE_CONFIG_DB      0           //config_db as is, before the record store
+#define STORE_COMPACT_DELAY 5000      //ms after the last save before the record store is compacted
+
+//Loco library, see loco_lib.h /////////////////////////////////////////////
+#define LOCO_LIB_LEN      1024        //entries, 16 bytes of the flash region and 4 bytes of RAM index each
+#define LOCO_LIB_PAGE     256         //bytes read from the flash region at once
+#define LOCO_LIB_CACHE    4           //pages kept in RAM
+#define LOCO_STATE_LEN    16          //locos with the speed and functions kept in RAM
 
 //Pins configuration ////////////////////////////////////////////////////////
 #define BT_COL_1          {0} //BOOT SEL PIN
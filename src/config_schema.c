@@ -0,0 +1,208 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "config_schema.h"
+#include "config.h"
+#include "log.h"
+#include "loco_lib.h"
+
+/* config_db as written before the record store, a copy of the structure at
+ * EE_CONFIG_DB */
+typedef struct {
+    char name[32];
+    uint16_t addr;
+    uint8_t ss;
+    uint32_t func;
+    int8_t speed;
+    bool dir_left;
+} loco_v0_t;
+
+typedef struct {
+    char ssid[32];
+    char pass[32];
+    uint8_t stop_mode;
+    uint8_t language_id;
+    uint8_t child_level;
+    uint16_t child_password;
+    uint8_t ipaddr[4];
+    uint8_t gwaddr[4];
+    uint8_t maskaddr[4];
+    bool dhcp;
+    uint8_t ip_z21[4];
+    uint16_t turnout_id;
+    bool turnout_state;
+    uint8_t loco_db_len;
+    uint8_t loco_db_pos;
+    loco_v0_t loco_db[64];      //LOCO_LIST_LEN of that firmware
+    uint8_t idle_time_min;
+    bool webpage_en;
+    uint8_t contrast;
+    uint16_t magic;
+} config_db_v0_t;
+
+/* LOCO section v1, the library was kept in config_db */
+typedef struct {
+    uint8_t loco_db_len;
+    uint8_t loco_db_pos;
+    loco_t loco_db[64];
+} config_loco_v1_t;
+
+#define V0(_field)          offsetof(config_db_v0_t, _field)
+#define V1(_field)          offsetof(config_loco_v1_t, _field)
+#define READ_V0(_field)     read(V0(_field), &config_db._field, sizeof(config_db._field))
+
+static bool migrate_wifi(uint8_t version, uint16_t len, config_store_reader_t read);
+static bool migrate_config(uint8_t version, uint16_t len, config_store_reader_t read);
+static bool migrate_loco(uint8_t version, uint16_t len, config_store_reader_t read);
+
+static const config_store_section_t sections[] = {
+    {CONFIG_TAG_WIFI, CONFIG_VER_WIFI, CONFIG_LEN_WIFI, &config_db.ssid, migrate_wifi},
+    {CONFIG_TAG_CONFIG, CONFIG_VER_CONFIG, CONFIG_LEN_CONFIG, &config_db.stop_mode, migrate_config},
+    {CONFIG_TAG_LOCO, CONFIG_VER_LOCO, CONFIG_LEN_LOCO, &config_db.loco_db_pos, migrate_loco},
+};
+#define SECTIONS_NUM        (sizeof(sections)/sizeof(sections[0]))
+// Reset by main_reset_data() when the section is missing
+static const config_flags_t section_flags[SECTIONS_NUM] = {DB_WIFI, DB_CONFIG, DB_LOCO_DB};
+
+static const uint8_t *legacy_image;
+static bool loco_kept;      //locos of the old section not in the library
+
+static bool migrate_wifi(uint8_t version, uint16_t len, config_store_reader_t read)
+{
+    if (version != 0) return false;
+    READ_V0(ssid);
+    READ_V0(pass);
+    READ_V0(ipaddr);
+    READ_V0(gwaddr);
+    READ_V0(maskaddr);
+    READ_V0(ip_z21);
+    READ_V0(dhcp);
+    return true;
+}
+
+static bool migrate_config(uint8_t version, uint16_t len, config_store_reader_t read)
+{
+    if (version != 0) return false;
+    READ_V0(stop_mode);
+    READ_V0(language_id);
+    READ_V0(child_level);
+    READ_V0(child_password);
+    READ_V0(idle_time_min);
+    READ_V0(webpage_en);
+    READ_V0(contrast);
+    READ_V0(turnout_state);
+    READ_V0(turnout_id);
+    return true;
+}
+
+/* Entry i of the library in the old section */
+static void read_loco(uint8_t version, uint16_t db, uint8_t i, config_store_reader_t read, loco_t *loco)
+{
+    if (version == 0) {
+        uint16_t entry = db + i * sizeof(loco_v0_t);
+        read(entry + offsetof(loco_v0_t, name), loco->name, LOCO_NAME_LEN);
+        read(entry + offsetof(loco_v0_t, addr), &loco->addr, sizeof(loco->addr));
+        read(entry + offsetof(loco_v0_t, ss), &loco->ss, sizeof(loco->ss));
+    } else {
+        read(db + i * sizeof(loco_t), loco, sizeof(*loco));
+    }
+    loco->name[LOCO_NAME_LEN] = '\0';
+}
+
+/* v0 kept the runtime state and a 32 byte name in each entry, v0 and v1 kept
+ * the library in config_db. The entries go to loco_lib.c, which skips the
+ * ones it has already, so an interrupted conversion is repeated safely. If
+ * they do not fit, e.g. without an FS area, the library only keeps them
+ * read-only and the page stays as it is. */
+static bool migrate_loco(uint8_t version, uint16_t len, config_store_reader_t read)
+{
+    uint16_t db;
+    uint8_t db_len, db_pos;
+    loco_t loco;
+
+    if (version == 0) {
+        read(V0(loco_db_len), &db_len, sizeof(db_len));
+        read(V0(loco_db_pos), &db_pos, sizeof(db_pos));
+        db = V0(loco_db);
+    } else if ((version == 1) && (len >= sizeof(config_loco_v1_t))) {
+        read(V1(loco_db_len), &db_len, sizeof(db_len));
+        read(V1(loco_db_pos), &db_pos, sizeof(db_pos));
+        db = V1(loco_db);
+    } else return false;
+
+    if (db_len > 64) db_len = 64;
+    for (uint8_t i=0; (i<db_len) && !loco_kept; i++) {
+        read_loco(version, db, i, read, &loco);
+        if (!loco_lib_add(&loco) && (loco_lib_find(loco.addr) == LOCO_LIB_NONE)) {
+            LOG_ERR("No room for the locos in the library, kept read-only\n\r");
+            loco_kept = true;
+        }
+    }
+    for (uint8_t i=0; (i<db_len) && loco_kept; i++) {
+        read_loco(version, db, i, read, &loco);
+        if (!loco_lib_keep(&loco)) return false;
+    }
+    config_db.loco_db_pos = db_pos;
+    return true;
+}
+
+static void read_legacy(uint16_t offset, void *buf, uint16_t len)
+{
+    memcpy(buf, &legacy_image[EE_CONFIG_DB + offset], len);
+}
+
+/* The page holds config_db as is, convert each section from version 0 */
+static uint8_t load_legacy(uint8_t *image, uint16_t size)
+{
+    uint16_t magic;
+    uint8_t found = 0;
+
+    if (EE_CONFIG_DB + sizeof(config_db_v0_t) > size) return 0;
+    memcpy(&magic, &image[EE_CONFIG_DB + V0(magic)], sizeof(magic));
+    if (magic != MAGIC_VALUE) return 0;
+    LOG_INFO("Converting config_db to the record store\n\r");
+    legacy_image = image;
+    for (uint8_t s=0; s<SECTIONS_NUM; s++) {
+        if (sections[s].migrate(0, sizeof(config_db_v0_t), read_legacy)) found |= 1 << s;
+    }
+    if (!loco_kept) config_store_compact();
+    return found;
+}
+
+/* Fill config_db from the page. Returns the DB_ flags of the parts which were
+ * not found or could not be converted, they need main_reset_data(), and
+ * CONFIG_SCHEMA_KEEP if the page must be left as it is. */
+config_flags_t config_schema_load(uint8_t *image, uint16_t size,
+                                  config_store_program_t program, config_store_commit_t commit)
+{
+    config_flags_t missing = 0;
+    uint8_t found;
+
+    loco_kept = false;
+    config_store_init(image, size, sections, SECTIONS_NUM, program, commit);
+    if (!config_store_load(&found)) found = load_legacy(image, size);
+    for (uint8_t s=0; s<SECTIONS_NUM; s++) {
+        if (!(found & (1 << s))) missing |= section_flags[s];
+    }
+    if (loco_kept) return missing | CONFIG_SCHEMA_KEEP;
+    // The library lives in the flash region, keep it without its position
+    if ((missing & DB_LOCO_DB) && loco_lib_count()) {
+        config_db.loco_db_pos = 0;
+        missing &= ~DB_LOCO_DB;
+    }
+    return missing;
+}
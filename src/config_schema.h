@@ -0,0 +1,59 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+/* config_db as sections of the config record store. A tag is never reused for
+ * other content. When the meaning of the bytes of a section changes, bump its
+ * version and convert the old one in its migration. Fields appended at the end
+ * of a section need neither, they read as zero from an older firmware. */
+#include <stddef.h>
+#include "config_store.h"
+#include "main_page.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_TAG_WIFI     0x01
+#define CONFIG_TAG_CONFIG   0x02
+#define CONFIG_TAG_LOCO     0x03
+
+#define CONFIG_VER_WIFI     1
+#define CONFIG_VER_CONFIG   1
+#define CONFIG_VER_LOCO     2
+
+#define CONFIG_LEN_WIFI     offsetof(config_db_t, stop_mode)
+#define CONFIG_LEN_CONFIG   (offsetof(config_db_t, loco_db_pos) - offsetof(config_db_t, stop_mode))
+#define CONFIG_LEN_LOCO     (sizeof(config_db_t) - offsetof(config_db_t, loco_db_pos))
+
+// Returned with the DB_ flags: an older page holds locos which could not be
+// moved to the library, they are kept read-only and it must not be written
+#define CONFIG_SCHEMA_KEEP  0x80
+
+// Page size the compacted store of config_db needs at most
+#define CONFIG_SCHEMA_SIZE  (CONFIG_STORE_HDR + CONFIG_STORE_SIZE(CONFIG_LEN_WIFI) + \
+                             CONFIG_STORE_SIZE(CONFIG_LEN_CONFIG) + CONFIG_STORE_SIZE(CONFIG_LEN_LOCO))
+
+config_flags_t config_schema_load(uint8_t *image, uint16_t size,
+                                  config_store_program_t program, config_store_commit_t commit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
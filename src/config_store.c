@@ -0,0 +1,314 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config_store.h"
+#include "config.h"
+#include "crc16.h"
+#include "log.h"
+
+/* Page layout: a 4 byte header, then the records back to back up to the first
+ * erased byte. A record header holds the section tag, the block number, the
+ * section version, the payload length, the section length and the CRC-16 over
+ * them and the payload, the payload follows padded to 4 bytes. Blocks without
+ * a record are all zero, block 0 of a section is always written so a section
+ * full of zeros is still found. Records of unknown sections are skipped and
+ * dropped by the next compaction. */
+#define STORE_HDR_LEN       CONFIG_STORE_HDR
+#define STORE_REC_HDR_LEN   CONFIG_STORE_REC_HDR
+#define STORE_BLOCK         CONFIG_STORE_BLOCK
+#define STORE_BLOCKS_MAX    (EE_SIZE / STORE_BLOCK)
+#define STORE_ERASED        0xFF
+#define STORE_RESERVE       (EE_SIZE / 4)   //free space below which the page is compacted when idle
+
+#define REC_TAG             0
+#define REC_BLOCK           1
+#define REC_VERSION         2
+#define REC_LEN             3
+#define REC_SECTION_LEN     4
+#define REC_CRC             6
+#define REC_SIZE(len)       ((STORE_REC_HDR_LEN + (len) + 3) & ~3)
+
+static uint8_t *image;
+static uint16_t image_size;
+static const config_store_section_t *sections;
+static uint8_t count;
+static uint8_t base[CONFIG_STORE_SECTIONS+1]; //first block of each section
+static uint16_t tail;                         //first free byte of the page
+static uint16_t rec_index[STORE_BLOCKS_MAX];  //offset of the latest record of each block, 0 for none
+static bool compact_pending;
+static config_store_program_t program_cb;
+static config_store_commit_t commit_cb;
+static config_store_stats_t stats;
+/* Section as stored, read by its migration */
+static uint8_t old_tag, old_version;
+static uint16_t old_len, old_end;
+
+static uint16_t record_crc(const uint8_t *rec)
+{
+    return crc16(&rec[STORE_REC_HDR_LEN], rec[REC_LEN], crc16(rec, REC_CRC, CRC16_INIT));
+}
+
+static inline uint16_t get16(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint8_t chunk_len(uint16_t len, uint8_t block)
+{
+    uint16_t left = len - block * STORE_BLOCK;
+    return (left < STORE_BLOCK) ? left : STORE_BLOCK;
+}
+
+static uint8_t block_len(uint8_t s, uint8_t block)
+{
+    return chunk_len(sections[s].len, block);
+}
+
+static uint8_t * block_data(uint8_t s, uint8_t block)
+{
+    return (uint8_t*)sections[s].data + block * STORE_BLOCK;
+}
+
+static int8_t find_section(uint8_t tag)
+{
+    for (uint8_t s=0; s<count; s++) {
+        if (sections[s].tag == tag) return s;
+    }
+    return -1;
+}
+
+static bool is_zero(const uint8_t *buf, uint8_t len)
+{
+    while (len--) {
+        if (*buf++) return false;
+    }
+    return true;
+}
+
+/* The block as stored, compared to its value in RAM */
+static bool block_changed(uint8_t s, uint8_t block)
+{
+    uint16_t rec = rec_index[base[s] + block];
+    if (!rec) return (block == 0) || !is_zero(block_data(s, block), block_len(s, block));
+    return memcmp(&image[rec + STORE_REC_HDR_LEN], block_data(s, block), block_len(s, block)) != 0;
+}
+
+static void append(uint8_t s, uint8_t block)
+{
+    uint8_t *rec = &image[tail];
+    uint8_t len = block_len(s, block);
+    uint16_t crc;
+
+    rec[REC_TAG] = sections[s].tag;
+    rec[REC_BLOCK] = block;
+    rec[REC_VERSION] = sections[s].version;
+    rec[REC_LEN] = len;
+    rec[REC_SECTION_LEN] = sections[s].len & 0xFF;
+    rec[REC_SECTION_LEN+1] = sections[s].len >> 8;
+    memcpy(&rec[STORE_REC_HDR_LEN], block_data(s, block), len);
+    memset(&rec[STORE_REC_HDR_LEN + len], 0, REC_SIZE(len) - STORE_REC_HDR_LEN - len);
+    crc = record_crc(rec);
+    rec[REC_CRC] = crc & 0xFF;
+    rec[REC_CRC+1] = crc >> 8;
+    rec_index[base[s] + block] = tail;
+    tail += REC_SIZE(len);
+}
+
+static void forget(uint8_t s)
+{
+    memset(&rec_index[base[s]], 0, (base[s+1] - base[s]) * sizeof(rec_index[0]));
+}
+
+/* config_store_reader_t of the section being migrated. Migrations are rare,
+ * so the log is searched for each block instead of keeping an index of it. */
+static void read_old(uint16_t offset, void *buf, uint16_t len)
+{
+    uint8_t *out = (uint8_t*)buf;
+
+    memset(buf, 0, len);
+    while (len) {
+        uint8_t block = offset / STORE_BLOCK;
+        uint8_t pos = offset % STORE_BLOCK;
+        uint8_t part = (len < STORE_BLOCK - pos) ? len : STORE_BLOCK - pos;
+        const uint8_t *latest = NULL;
+
+        for (uint16_t off=STORE_HDR_LEN; off<old_end; off+=REC_SIZE(image[off+REC_LEN])) {
+            const uint8_t *rec = &image[off];
+            if ((rec[REC_TAG] == old_tag) && (rec[REC_BLOCK] == block) && (rec[REC_VERSION] == old_version) &&
+                (get16(&rec[REC_SECTION_LEN]) == old_len)) latest = rec;
+        }
+        if (latest && (pos < latest[REC_LEN])) {
+            memcpy(out, &latest[STORE_REC_HDR_LEN + pos], (part < latest[REC_LEN] - pos) ? part : latest[REC_LEN] - pos);
+        }
+        out += part;
+        offset += part;
+        len -= part;
+    }
+}
+
+/* image is the RAM copy of the page, sections the configuration kept in it */
+void config_store_init(uint8_t *ee_image, uint16_t size, const config_store_section_t *config, uint8_t num,
+                       config_store_program_t program, config_store_commit_t commit)
+{
+    image = ee_image;
+    image_size = size;
+    sections = config;
+    count = (num < CONFIG_STORE_SECTIONS) ? num : CONFIG_STORE_SECTIONS;
+    base[0] = 0;
+    for (uint8_t s=0; s<count; s++) {
+        base[s+1] = base[s] + (sections[s].len + STORE_BLOCK - 1) / STORE_BLOCK;
+    }
+    program_cb = program;
+    commit_cb = commit;
+}
+
+/* Replay the records into the sections. Returns false if the page does not
+ * hold a store, found gets a bit for each section read from the page, the
+ * others are zeroed. Only the record headers are walked and each block is
+ * copied once, sections stored with another version are handed to their
+ * migration. A damaged record ends the replay, the bytes behind it can not be
+ * programmed again, so the page is compacted before the next append. */
+bool config_store_load(uint8_t *found)
+{
+    uint8_t version[CONFIG_STORE_SECTIONS];
+    uint16_t len[CONFIG_STORE_SECTIONS];
+    uint8_t seen = 0;
+
+    *found = 0;
+    for (uint8_t s=0; s<count; s++) memset(sections[s].data, 0, sections[s].len);
+    memset(rec_index, 0, sizeof(rec_index));
+    tail = image_size;
+    if (get16(image) != EE_STORE_MAGIC) return false;
+
+    uint16_t off = STORE_HDR_LEN;
+    while (off + STORE_REC_HDR_LEN <= image_size) {
+        const uint8_t *rec = &image[off];
+        if (rec[REC_TAG] == STORE_ERASED) {
+            tail = off;
+            break;
+        }
+        if ((rec[REC_LEN] > STORE_BLOCK) || (off + REC_SIZE(rec[REC_LEN]) > image_size) ||
+            (record_crc(rec) != get16(&rec[REC_CRC]))) {
+            LOG_ERR("Config store record damaged\n\r");
+            compact_pending = true;
+            break;
+        }
+        int8_t s = find_section(rec[REC_TAG]);
+        if (s >= 0) {
+            uint16_t rec_len = get16(&rec[REC_SECTION_LEN]);
+            if (!(seen & (1 << s)) || (version[s] != rec[REC_VERSION]) || (len[s] != rec_len)) {
+                //first record or the section was rewritten by another firmware
+                forget(s);
+                seen |= 1 << s;
+                version[s] = rec[REC_VERSION];
+                len[s] = rec_len;
+            }
+            if ((rec[REC_BLOCK] < base[s+1] - base[s]) && (rec[REC_LEN] == chunk_len(rec_len, rec[REC_BLOCK])))
+                rec_index[base[s] + rec[REC_BLOCK]] = off;
+        }
+        off += REC_SIZE(rec[REC_LEN]);
+    }
+    old_end = (tail < image_size) ? tail : off;
+
+    for (uint8_t s=0; s<count; s++) {
+        if (!(seen & (1 << s))) continue;
+        if (version[s] == sections[s].version) {
+            for (uint8_t block=0; block<base[s+1]-base[s]; block++) {
+                uint16_t rec = rec_index[base[s] + block];
+                uint8_t n = block_len(s, block);
+                if (!rec) continue;
+                if (image[rec + REC_LEN] < n) n = image[rec + REC_LEN];
+                memcpy(block_data(s, block), &image[rec + STORE_REC_HDR_LEN], n);
+            }
+            *found |= 1 << s;
+            if (len[s] == sections[s].len) continue;
+        } else {
+            old_tag = sections[s].tag;
+            old_version = version[s];
+            old_len = len[s];
+            if (sections[s].migrate && sections[s].migrate(version[s], len[s], read_old)) {
+                *found |= 1 << s;
+                stats.migrations++;
+            } else {
+                LOG_ERR("Config section not converted\n\r");
+                memset(sections[s].data, 0, sections[s].len);
+            }
+        }
+        //stored with another layout, written again as a whole
+        forget(s);
+        compact_pending = true;
+    }
+    stats.used = old_end;
+    return true;
+}
+
+/* Append the changed blocks. Nothing is written if none changed, the page is
+ * compacted right away if they do not fit. */
+bool config_store_save(void)
+{
+    uint16_t start = tail;
+
+    for (uint8_t s=0; s<count; s++) {
+        for (uint8_t block=0; block<base[s+1]-base[s]; block++) {
+            if (!block_changed(s, block)) continue;
+            if (tail + REC_SIZE(block_len(s, block)) > image_size) return config_store_compact();
+            append(s, block);
+            stats.records++;
+        }
+    }
+    if (tail == start) {
+        stats.skipped++;
+        return true;
+    }
+    stats.saves++;
+    stats.bytes += tail - start;
+    stats.used = tail;
+    if (image_size - tail < STORE_RESERVE) compact_pending = true;
+    return program_cb ? program_cb(start, tail - start) : false;
+}
+
+/* Rewrite the page with the latest record of each non-zero block */
+bool config_store_compact(void)
+{
+    memset(image, STORE_ERASED, image_size);
+    memset(rec_index, 0, sizeof(rec_index));
+    image[0] = EE_STORE_MAGIC & 0xFF;
+    image[1] = EE_STORE_MAGIC >> 8;
+    image[2] = 0;
+    image[3] = 0;
+    tail = STORE_HDR_LEN;
+    for (uint8_t s=0; s<count; s++) {
+        for (uint8_t block=0; block<base[s+1]-base[s]; block++) {
+            if ((block == 0) || !is_zero(block_data(s, block), block_len(s, block))) append(s, block);
+        }
+    }
+    compact_pending = false;
+    stats.compactions++;
+    stats.used = tail;
+    return commit_cb ? commit_cb() : false;
+}
+
+/* The free space runs low, a record is damaged or a section was converted,
+ * compact when idle */
+bool config_store_compact_pending(void)
+{
+    return compact_pending;
+}
+
+void config_store_get_stats(config_store_stats_t *out)
+{
+    *out = stats;
+}
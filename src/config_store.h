@@ -0,0 +1,83 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+/* Log-structured store of the configuration in the emulated EEPROM page.
+ * The configuration is a set of tagged sections, each split into blocks. A
+ * save appends a record with its own CRC for each block which changed since
+ * the last one. Every record carries the tag, version and length of its
+ * section, so a firmware with a different layout keeps the data it knows.
+ * The page is only erased and rewritten when it is compacted to the latest
+ * record of each block, all other saves program the appended bytes into
+ * erased flash. */
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_STORE_BLOCK      32
+#define CONFIG_STORE_REC_HDR    8
+#define CONFIG_STORE_SECTIONS   8
+// Page size the compacted store of a section of len bytes needs at most, the header excluded
+#define CONFIG_STORE_SIZE(len)  (((len) + CONFIG_STORE_BLOCK - 1) / CONFIG_STORE_BLOCK * (CONFIG_STORE_REC_HDR + CONFIG_STORE_BLOCK))
+#define CONFIG_STORE_HDR        4
+
+// Program len bytes of the RAM image at offset into the erased page, both 4-byte aligned
+typedef bool (*config_store_program_t)(uint16_t offset, uint16_t len);
+// Erase the page and write the whole RAM image
+typedef bool (*config_store_commit_t)(void);
+// Copy len bytes at offset of the section as stored, bytes without a record read as zero
+typedef void (*config_store_reader_t)(uint16_t offset, void *buf, uint16_t len);
+// Convert a section stored with another version of len bytes into data
+typedef bool (*config_store_migrate_t)(uint8_t version, uint16_t len, config_store_reader_t read);
+
+typedef struct
+{
+    uint8_t tag;            // 0x01-0xFE, never reused for other content
+    uint8_t version;        // bumped when the meaning of the bytes changes
+    uint16_t len;           // growing a section at its end needs no new version
+    void *data;
+    config_store_migrate_t migrate;
+} config_store_section_t;
+
+typedef struct
+{
+    uint32_t saves;         // saves which appended records
+    uint32_t skipped;       // saves without any change, nothing written
+    uint32_t records;       // records appended
+    uint32_t bytes;         // bytes programmed by the appends
+    uint32_t compactions;   // page erases
+    uint32_t migrations;    // sections converted from another version
+    uint16_t used;          // bytes of the page holding the header and the records
+} config_store_stats_t;
+
+void config_store_init(uint8_t *image, uint16_t size, const config_store_section_t *sections, uint8_t count,
+                       config_store_program_t program, config_store_commit_t commit);
+bool config_store_load(uint8_t *found);
+bool config_store_save(void);
+bool config_store_compact(void);
+bool config_store_compact_pending(void);
+void config_store_get_stats(config_store_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC16_INIT  0xFFFF
+
+/* CRC-16/CCITT (polynomial 0x1021, MSB first). Pass CRC16_INIT or the result
+ * of the previous part to continue over several buffers. */
+uint16_t crc16(const void *buf, uint16_t len, uint16_t crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,37 +14,87 @@
  * You should have received a copy of the GNU General Public License 
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include <string.h>
+#include <Esp.h>
 #include "config.h"
 #include "eeprom_hl.h"
 
 /**********************************************************************************/
-void EEPROMwrite(uint8_t start, uint8_t * data, uint16_t len)
+static inline bool EEPROMinRange(uint32_t offset, uint32_t len)
 {
-  for (int i = 0; i < len; i++) {
-     EEPROM.write(start+i,data[i]);
-  }
+  return (offset <= EEPROM.length()) && (len <= EEPROM.length() - offset);
 }
 
-void EEPROMread(uint8_t start, uint8_t * data, uint16_t len)
+/* Block copies between the RAM copy of the page and a buffer, the range is
+ * checked once per block instead of once per byte */
+bool EEPROMreadBlock(uint32_t offset, void * data, uint32_t len)
 {
-  for (int i = 0; i < len; i++) {
-     data[i] = EEPROM.read(start+i);
-  }
+  if (!EEPROMinRange(offset, len) || !EEPROM.getConstDataPtr()) return false;
+  memcpy(data, EEPROM.getConstDataPtr() + offset, len);
+  return true;
+}
+
+/* The copy is written to flash by the next EEPROM.commit() */
+bool EEPROMwriteBlock(uint32_t offset, const void * data, uint32_t len)
+{
+  if (!EEPROMinRange(offset, len) || !EEPROM.getConstDataPtr()) return false;
+  memcpy(EEPROM.getDataPtr() + offset, data, len);  //getDataPtr() marks the copy dirty
+  return true;
+}
+
+/* Compare before write: the block is copied and the page committed only if
+ * the contents differ, an unchanged block costs no flash erase */
+bool EEPROMupdateBlock(uint32_t offset, const void * data, uint32_t len)
+{
+  if (!EEPROMinRange(offset, len) || !EEPROM.getConstDataPtr()) return false;
+  if (memcmp(EEPROM.getConstDataPtr() + offset, data, len) == 0) return true;
+  memcpy(EEPROM.getDataPtr() + offset, data, len);
+  return EEPROM.commit();
+}
+
+void EEPROMwrite(uint32_t start, uint8_t * data, uint16_t len)
+{
+  EEPROMwriteBlock(start, data, len);
+}
+
+void EEPROMread(uint32_t start, uint8_t * data, uint16_t len)
+{
+  EEPROMreadBlock(start, data, len);
+}
+
+/**********************************************************************************/
+extern "C" uint32_t _EEPROM_start;  //flash page of the EEPROM class, from the linker script
+
+/* RAM copy of the page, read by EEPROM.begin() */
+uint8_t *EEPROMimage(void)
+{
+  return EEPROM.getDataPtr();
+}
+
+/* Program bytes appended to the RAM copy into the page. They must still be
+ * erased in flash, EEPROM.commit() would erase and rewrite all of it. */
+bool EEPROMprogram(uint16_t offset, uint16_t len)
+{
+  uint32_t addr = ((uint32_t)(uintptr_t)&_EEPROM_start - 0x40200000) + offset;
+  return ESP.flashWrite(addr, (uint32_t*)(EEPROM.getConstDataPtr() + offset), len);
+}
+
+bool EEPROMcommitPage(void)
+{
+  EEPROM.getDataPtr(); //marks the copy dirty, commit() writes nothing otherwise
+  return EEPROM.commit();
 }
 
 /**********************************************************************************/
-void EEPROMwriteIP(uint8_t start, IPAddress ip)
+void EEPROMwriteIP(uint32_t start, IPAddress ip)
 {
-  for (uint8_t i = 0; i < 4; i++) {
-     EEPROM.write(start+i,ip[i]);
-  }
+  uint8_t addr[4] = {ip[0], ip[1], ip[2], ip[3]};
+  EEPROMwriteBlock(start, addr, sizeof(addr));
 }
 
-IPAddress EEPROMreadIP(uint8_t start)
+IPAddress EEPROMreadIP(uint32_t start)
 {
-  IPAddress ip;
-  for (uint8_t i = 0; i < 4; i++) {
-     ip[i] = EEPROM.read(start+i);
-  }
-  return ip;
+  uint8_t addr[4] = {0, 0, 0, 0};
+  EEPROMreadBlock(start, addr, sizeof(addr));
+  return IPAddress(addr[0], addr[1], addr[2], addr[3]);
 }
@@ -17,12 +17,30 @@
 #ifndef EEPROM_CONF_H
 #define EEPROM_CONF_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
 #include <IPAddress.h>
 #include <EEPROM.h>
 
-void EEPROMwrite(uint8_t start, uint8_t * data, uint16_t len);
-void EEPROMread(uint8_t start, uint8_t * data, uint16_t len);
-void EEPROMwriteIP(uint8_t start, IPAddress ip);
-IPAddress EEPROMreadIP(uint8_t start);
+void EEPROMwriteIP(uint32_t start, IPAddress ip);
+IPAddress EEPROMreadIP(uint32_t start);
+
+extern "C" {
+#endif
+
+bool EEPROMreadBlock(uint32_t offset, void * data, uint32_t len);
+bool EEPROMwriteBlock(uint32_t offset, const void * data, uint32_t len);
+bool EEPROMupdateBlock(uint32_t offset, const void * data, uint32_t len);
+void EEPROMwrite(uint32_t start, uint8_t * data, uint16_t len);
+void EEPROMread(uint32_t start, uint8_t * data, uint16_t len);
+uint8_t *EEPROMimage(void);
+bool EEPROMprogram(uint16_t offset, uint16_t len);
+bool EEPROMcommitPage(void);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <Esp.h>
+#include "flash_region.h"
+#include "log.h"
+
+extern "C" uint32_t _FS_start;  //FS area of the flash layout, from the linker script
+extern "C" uint32_t _FS_end;
+
+#define FLASH_BASE      0x40200000
+#define REGION_START    ((uint32_t)(uintptr_t)&_FS_start - FLASH_BASE)
+
+uint32_t flash_region_size(void)
+{
+  return (uint32_t)(uintptr_t)&_FS_end - (uint32_t)(uintptr_t)&_FS_start;
+}
+
+bool flash_region_read(uint32_t offset, void *buf, uint32_t len)
+{
+  if ((offset > flash_region_size()) || (len > flash_region_size() - offset)) return false;
+  return ESP.flashRead(REGION_START + offset, (uint8_t*)buf, len);
+}
+
+/* Only clears bits, so it is programmed without an erase */
+static bool programmable(const uint8_t *old, const uint8_t *data, uint32_t len)
+{
+  while (len--) {
+    if ((*old++ & *data) != *data) return false;
+    data++;
+  }
+  return true;
+}
+
+/* Read-modify-write of each sector. A sector already holding the data is not
+ * written, one where the data only fills erased bytes is not erased. */
+bool flash_region_write(uint32_t offset, const void *buf, uint32_t len)
+{
+  const uint8_t *src = (const uint8_t*)buf;
+  uint8_t *sector;
+  bool ret = true;
+
+  if ((offset > flash_region_size()) || (len > flash_region_size() - offset)) return false;
+  sector = (uint8_t*)malloc(FLASH_REGION_SECTOR);
+  if (!sector) {
+    LOG_ERR("No memory for the flash sector\n\r");
+    return false;
+  }
+  while (len && ret) {
+    uint32_t base = offset & ~(FLASH_REGION_SECTOR - 1);
+    uint32_t pos = offset - base;
+    uint32_t part = (len < FLASH_REGION_SECTOR - pos) ? len : FLASH_REGION_SECTOR - pos;
+
+    ret = ESP.flashRead(REGION_START + base, (uint32_t*)sector, FLASH_REGION_SECTOR);
+    if (ret && memcmp(&sector[pos], src, part)) {
+      bool erase = !programmable(&sector[pos], src, part);
+      memcpy(&sector[pos], src, part);
+      if (erase) ret = ESP.flashEraseSector((REGION_START + base) / FLASH_REGION_SECTOR);
+      ret = ret && ESP.flashWrite(REGION_START + base, (uint32_t*)sector, FLASH_REGION_SECTOR);
+    }
+    src += part;
+    offset += part;
+    len -= part;
+  }
+  free(sector);
+  return ret;
+}
+
+/* Erase the sectors of offset..offset+len, both multiples of the sector size */
+bool flash_region_erase(uint32_t offset, uint32_t len)
+{
+  if ((offset % FLASH_REGION_SECTOR) || (len % FLASH_REGION_SECTOR)) return false;
+  if ((offset > flash_region_size()) || (len > flash_region_size() - offset)) return false;
+  for (uint32_t addr = REGION_START + offset; addr < REGION_START + offset + len; addr += FLASH_REGION_SECTOR) {
+    if (!ESP.flashEraseSector(addr / FLASH_REGION_SECTOR)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,42 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+/* Flash area behind the firmware for data too large for the EEPROM page, the
+ * FS area of the flash layout as the firmware uses no file system. It is read
+ * and written at any offset, a write erases and rewrites the sectors it
+ * touches, so it suits data which is read often and written rarely. */
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_REGION_SECTOR 4096
+
+uint32_t flash_region_size(void);
+bool flash_region_read(uint32_t offset, void *buf, uint32_t len);
+bool flash_region_write(uint32_t offset, const void *buf, uint32_t len);
+bool flash_region_erase(uint32_t offset, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,25 +1,28 @@
-/* 
+/*
  * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
  * Copyright (c) 2020 Anton Nadezhdin.
- * 
- * This program is free software: you can redistribute it and/or modify  
- * it under the terms of the GNU General Public License as published by  
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, version 3.
  *
- * This program is distributed in the hope that it will be useful, but 
- * WITHOUT ANY WARRANTY; without even the implied warranty of 
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
  * General Public License for more details.
  *
- * You should have received a copy of the GNU General Public License 
+ * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+/* Generated by bmp/bmp2page, do not edit */
 #include "stdint.h"
 
 #ifndef PROGMEM
 #define PROGMEM
 #endif
 
+/* Page-major image: (height+7)/8 pages of width column bytes, bit 0 is the
+ * top pixel of the page and unused bits of the last page are zero */
 typedef struct {
 	uint8_t width;
 	uint8_t height;
@@ -27,165 +30,163 @@ typedef struct {
 }bitmap_t;
 
 static bitmap_t PROGMEM ant = { 9, 20, {
-	0x10, 0x00, 0x11, 0x01, 0x11, 0x01, 0x92, 0x00, 0x92, 0x00, 0x54, 0x00,
-	0x54, 0x00, 0x38, 0x00, 0x38, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00,
-	0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00,
-	0x10, 0x00, 0x10, 0x00, }
+	0x06, 0x18, 0x60, 0x80, 0xFF, 0x80, 0x60, 0x18, 0x06, 0x00, 0x00, 0x00,
+	0x01, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x00,
+	0x00, 0x00, 0x00, }
 	};
 static bitmap_t PROGMEM bat = { 16, 7, {
-	0xFE, 0xFF, 0x02, 0x80, 0x03, 0x80, 0x03, 0x80, 0x03, 0x80, 0x02, 0x80,
-	0xFE, 0xFF, }
+	0x1C, 0x7F, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41,
+	0x41, 0x41, 0x41, 0x7F, }
 	};
 static bitmap_t PROGMEM left = { 6, 11, {
-	0x20, 0x30, 0x38, 0x3C, 0x3E, 0x3F, 0x3E, 0x3C, 0x38, 0x30, 0x20, }
+	0x20, 0x70, 0xF8, 0xFC, 0xFE, 0xFF, 0x00, 0x00, 0x00, 0x01, 0x03, 0x07, }
 	};
 static bitmap_t PROGMEM light = { 9, 9, {
-	0x10, 0x00, 0x92, 0x00, 0x54, 0x00, 0x38, 0x00, 0xFF, 0x01, 0x38, 0x00,
-	0x54, 0x00, 0x92, 0x00, 0x10, 0x00, }
+	0x10, 0x92, 0x54, 0x38, 0xFF, 0x38, 0x54, 0x92, 0x10, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x00, 0x00, 0x00, 0x00, }
 	};
 static bitmap_t PROGMEM logo = { 128, 53, {
-  0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xE3,
-  0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0xF0, 0x70, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x70, 0x3C, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x38,
-  0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0xC0, 0x07, 0x38, 0xC0, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x01, 0xF0, 0x01, 0x0F, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x00, 0x70,
-  0x03, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x1F, 0x00, 0x00, 0x02, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0xC0, 0x07, 0x00, 0x8F, 0x02, 0x40, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x03, 0x00, 0xE8,
-  0x06, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x0F, 0x80, 0xFF, 0x07, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x80, 0xFF, 0x07, 0xC0, 0x0F, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xF0, 0x80, 0xFF,
-  0x1E, 0xF0, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0xE0, 0xC1, 0x03, 0xFC, 0x0F, 0x7C, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0xE0, 0x07, 0xCF, 0xFF, 0x1F, 0x1F, 0x0C, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x1E, 0x3C, 0x00,
-  0xC0, 0x07, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x60, 0x78, 0xF8, 0x00, 0xF0, 0x81, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x60, 0xE0, 0xC1, 0x03, 0x7C, 0xE0, 0x0D, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x87, 0x07, 0x0F,
-  0x1F, 0xF0, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x60, 0x0F, 0x1E, 0xFC, 0x03, 0xF6, 0x0D, 0x06, 0x07, 0x3B, 0x38, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x60, 0x1F, 0x78, 0xF0, 0x80, 0xF7, 0x0D, 0x0E,
-  0x07, 0x3B, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x3E, 0xE0, 0x01,
-  0x80, 0xF7, 0x0D, 0x8C, 0x8F, 0x79, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x60, 0x3E, 0x80, 0x07, 0xC8, 0xF7, 0x0C, 0x8C, 0x8D, 0x79, 0x3C, 0x3C,
-  0x0C, 0xE3, 0x83, 0x03, 0x60, 0x3E, 0x00, 0x1E, 0xDE, 0xB7, 0x0C, 0x8C,
-  0x8D, 0x59, 0x34, 0x7E, 0x0C, 0xF3, 0xC7, 0x07, 0x60, 0x36, 0x40, 0x38,
-  0xDF, 0xA7, 0x0C, 0xD8, 0xDD, 0xD8, 0x36, 0xE7, 0x0C, 0x33, 0x66, 0x0C,
-  0x60, 0x36, 0xC0, 0x32, 0xDF, 0xE7, 0x0C, 0xD8, 0xD8, 0xD8, 0x36, 0xC3,
-  0x0C, 0xF3, 0xE0, 0x0F, 0x60, 0x26, 0xC0, 0x76, 0xDF, 0xE6, 0x0C, 0xD8,
-  0xD8, 0xD8, 0x36, 0xC3, 0x0C, 0xE3, 0xE3, 0x0F, 0x60, 0x3E, 0x87, 0x66,
-  0xDF, 0x46, 0x0C, 0xF0, 0xF8, 0x98, 0x33, 0xC3, 0x0C, 0x03, 0x67, 0x00,
-  0x60, 0x3E, 0x0F, 0x66, 0xDF, 0xC6, 0x0C, 0x70, 0x70, 0x98, 0x33, 0xE7,
-  0x8C, 0x33, 0xE6, 0x0C, 0x60, 0x16, 0xCF, 0x66, 0xDB, 0xE6, 0x0C, 0x70,
-  0x70, 0x98, 0x33, 0x7E, 0xFC, 0xF3, 0xC7, 0x07, 0x60, 0x36, 0xDF, 0x66,
-  0xDA, 0xA6, 0x0C, 0x70, 0x70, 0x18, 0x31, 0x3C, 0x78, 0xE3, 0x83, 0x03,
-  0x60, 0x36, 0xDB, 0x66, 0xDA, 0xA6, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x60, 0x36, 0xD8, 0x66, 0xDA, 0xA6, 0x0D, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xBF, 0xDE, 0x66,
-  0xDE, 0xF6, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x60, 0xFF, 0xDF, 0x66, 0xDE, 0xF6, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x60, 0x77, 0xDB, 0x66, 0xD2, 0xF7, 0x0D, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x76, 0xDB, 0x66,
-  0xD2, 0xF7, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0xC0, 0x64, 0xDF, 0x66, 0xDA, 0xF7, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0xC0, 0x61, 0xDF, 0x66, 0xDE, 0x37, 0x06, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x07, 0xDF, 0x66,
-  0xDE, 0x07, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x1E, 0xDE, 0x66, 0xDF, 0xC3, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0xD8, 0x66, 0x9F, 0xF1, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xD1, 0x66,
-  0x1F, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x80, 0xC7, 0x67, 0x0F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x66, 0xC7, 0x07, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x64,
-  0xF1, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0xE0, 0x61, 0x7C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x63, 0x1F, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE2,
-  0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0xE0, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, }
-  };
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x80, 0x80, 0xC0, 0xC0, 0xE0, 0x60, 0x70, 0x30, 0x38, 0x18, 0x1C, 0x0C,
+	0x06, 0x06, 0x03, 0x63, 0xFB, 0xFF, 0x9E, 0x86, 0x8C, 0x0C, 0x18, 0x18,
+	0x30, 0x30, 0x60, 0x60, 0xC0, 0xC0, 0x80, 0x80, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0xC0, 0xCC, 0x8C, 0x9E, 0x1E, 0x37, 0x33, 0x63, 0x61, 0xC1, 0xC0,
+	0x80, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x74, 0x74, 0xF4, 0xFC,
+	0xF1, 0xF9, 0xF9, 0xFC, 0xB1, 0xFF, 0xF8, 0xC0, 0x40, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x81, 0x81, 0xC3, 0xC3, 0xE6, 0x62, 0x70, 0x30, 0xF8, 0xF8,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x01,
+	0x71, 0xF3, 0xF3, 0xE6, 0xC6, 0x8C, 0x0C, 0x18, 0x19, 0x31, 0x33, 0x67,
+	0x66, 0xC6, 0xCD, 0x8D, 0x99, 0x19, 0x31, 0x31, 0x61, 0x61, 0x61, 0x61,
+	0x31, 0x31, 0x19, 0x19, 0x1D, 0x0C, 0x0E, 0xC6, 0xC7, 0xE3, 0xE3, 0x01,
+	0xF1, 0xF8, 0xF8, 0xFC, 0xFC, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x60, 0xE0, 0xC0, 0x00, 0x00, 0x00, 0x80, 0xE0, 0xE0, 0xE0, 0x80,
+	0x00, 0x00, 0x00, 0x80, 0xE0, 0x60, 0x00, 0xE0, 0xE0, 0xE0, 0x80, 0x00,
+	0x00, 0x00, 0x80, 0xE0, 0xE0, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0x63,
+	0xEF, 0x7F, 0x00, 0x00, 0xE0, 0xE0, 0xE0, 0xC0, 0x00, 0x00, 0x9C, 0xB9,
+	0x01, 0xFB, 0xF3, 0x06, 0x1E, 0xFC, 0xF0, 0x00, 0xFC, 0xFE, 0x7E, 0xFF,
+	0xFE, 0x00, 0xFF, 0xFF, 0x0F, 0xFF, 0xFF, 0x00, 0x03, 0x9F, 0xF9, 0xDF,
+	0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x1F,
+	0xFC, 0xE0, 0xFC, 0x3F, 0x07, 0x00, 0x07, 0x3F, 0xFC, 0xE0, 0xFC, 0x3F,
+	0x03, 0x00, 0x00, 0xFF, 0xFF, 0x01, 0x1F, 0xFC, 0xE0, 0xFC, 0x1F, 0x01,
+	0xFF, 0xFF, 0x00, 0x00, 0x7C, 0xFE, 0xC7, 0x83, 0x83, 0xC7, 0xFE, 0x7C,
+	0x00, 0x00, 0xFF, 0xFF, 0x80, 0x80, 0x80, 0xC0, 0xFF, 0xFF, 0x00, 0x00,
+	0xCE, 0xDF, 0x9B, 0x9B, 0xB3, 0xF7, 0xE6, 0x00, 0x00, 0x7C, 0xFE, 0xDB,
+	0x9B, 0x9B, 0xDE, 0x5C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x7F, 0xFF, 0x80, 0x38, 0x7F, 0xFF, 0x18, 0x7F, 0xFF, 0xF0, 0x18,
+	0xF3, 0xFB, 0x99, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x00,
+	0x00, 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0x18, 0x9F, 0xFF, 0x00, 0xFF, 0xFF,
+	0xE0, 0xFF, 0xFF, 0x00, 0xF8, 0xFF, 0xF8, 0xFF, 0x7E, 0x00, 0xFF, 0xFF,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x01, 0x01, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03,
+	0x03, 0x06, 0x06, 0x0C, 0x0C, 0x19, 0x19, 0x30, 0x33, 0x67, 0x67, 0xCF,
+	0xDF, 0x80, 0xBF, 0x3F, 0x20, 0x7F, 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0x00,
+	0xFC, 0x7F, 0x7F, 0x3F, 0x9F, 0x80, 0xC7, 0xCF, 0xEF, 0x67, 0x73, 0x30,
+	0x39, 0x19, 0x0C, 0x0C, 0x06, 0x07, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x03,
+	0x03, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x0C, 0x0E, 0x06, 0x07, 0x03,
+	0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, }
+	};
 static bitmap_t PROGMEM pause = { 5, 11, {
-	0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, 0x1B, }
+	0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x07, 0x07, 0x00, 0x07, 0x07, }
 	};
 static bitmap_t PROGMEM right = { 6, 11, {
-	0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x1F, 0x0F, 0x07, 0x03, 0x01, }
+	0xFF, 0xFE, 0xFC, 0xF8, 0x70, 0x20, 0x07, 0x03, 0x01, 0x00, 0x00, 0x00, }
 	};
 static bitmap_t PROGMEM sc = { 11, 22, {
-	0x30, 0x06, 0x30, 0x07, 0xF8, 0x03, 0xF8, 0x01, 0xF8, 0x00, 0x7C, 0x00,
-	0x3C, 0x00, 0x1C, 0x04, 0x1E, 0x07, 0xCE, 0x07, 0xFE, 0x03, 0xBF, 0x03,
-	0x8F, 0x01, 0xC3, 0x01, 0xC1, 0x00, 0xE0, 0x00, 0x60, 0x00, 0x60, 0x00,
-	0x20, 0x00, 0xF8, 0x00, 0x70, 0x00, 0x20, 0x00, }
+	0x00, 0x00, 0xE0, 0xFC, 0xFF, 0x7F, 0x3C, 0x1C, 0x0E, 0x07, 0x83, 0x78,
+	0x3F, 0x1F, 0x1F, 0x0D, 0x8C, 0xE6, 0xFE, 0x3F, 0x0F, 0x03, 0x00, 0x00,
+	0x00, 0x08, 0x18, 0x3F, 0x1B, 0x08, 0x00, 0x00, 0x00, }
 	};
 static bitmap_t PROGMEM shift = { 9, 8, {
-	0x10, 0x00, 0x28, 0x00, 0x44, 0x00, 0x82, 0x00, 0xC7, 0x01, 0x44, 0x00,
-	0x44, 0x00, 0x7C, 0x00, }
+	0x10, 0x18, 0xF4, 0x82, 0x81, 0x82, 0xF4, 0x18, 0x10, }
 	};
 static bitmap_t PROGMEM shift_20 = { 9, 8, {
-	0x10, 0x00, 0x38, 0x00, 0x7C, 0x00, 0xFE, 0x00, 0xFF, 0x01, 0x7C, 0x00,
-	0x7C, 0x00, 0x7C, 0x00, }
+	0x10, 0x18, 0xFC, 0xFE, 0xFF, 0xFE, 0xFC, 0x18, 0x10, }
 	};
 static bitmap_t PROGMEM smoke = { 26, 7, {
-	0x00, 0xE0, 0x56, 0x01, 0x00, 0x3F, 0xA0, 0x01, 0x80, 0x48, 0x10, 0x00,
-	0xE0, 0x12, 0x07, 0x00, 0x50, 0xF8, 0x01, 0x00, 0x90, 0x0F, 0x00, 0x00,
-	0xE8, 0x00, 0x00, 0x00, }
+	0x00, 0x00, 0x00, 0x40, 0x30, 0x48, 0x58, 0x6C, 0x22, 0x2A, 0x22, 0x36,
+	0x1A, 0x13, 0x15, 0x11, 0x18, 0x09, 0x09, 0x00, 0x05, 0x02, 0x01, 0x02,
+	0x03, 0x00, }
 	};
 static bitmap_t PROGMEM smoke_f = { 26, 7, {
-	0xAA, 0x1D, 0x00, 0x00, 0x16, 0xF0, 0x03, 0x00, 0x20, 0x48, 0x04, 0x00,
-	0x80, 0x23, 0x1D, 0x00, 0x00, 0x7E, 0x28, 0x00, 0x00, 0xC0, 0x27, 0x00,
-	0x00, 0x00, 0x5C, 0x00, }
+	0x00, 0x03, 0x02, 0x01, 0x02, 0x05, 0x00, 0x09, 0x09, 0x18, 0x11, 0x15,
+	0x13, 0x1A, 0x36, 0x22, 0x2A, 0x22, 0x6C, 0x58, 0x48, 0x30, 0x40, 0x00,
+	0x00, 0x00, }
 	};
 static bitmap_t PROGMEM stop = { 26, 20, {
-	0xC0, 0xFF, 0x0F, 0x00, 0xE0, 0xFF, 0x1F, 0x00, 0xF0, 0xFF, 0x3F, 0x00,
-	0xF8, 0xFF, 0x7F, 0x00, 0xFC, 0xFF, 0xFF, 0x00, 0xFE, 0xFF, 0xFF, 0x01,
-	0xFF, 0xFF, 0xFF, 0x03, 0xC7, 0x60, 0x8C, 0x03, 0xBB, 0xBB, 0x6B, 0x03,
-	0xFB, 0xBB, 0x6B, 0x03, 0xC7, 0xBB, 0x8B, 0x03, 0xBF, 0xBB, 0xEB, 0x03,
-	0xBB, 0xBB, 0xEB, 0x03, 0xC7, 0x7B, 0xEC, 0x03, 0xFE, 0xFF, 0xFF, 0x01,
-	0xFC, 0xFF, 0xFF, 0x00, 0xF8, 0xFF, 0x7F, 0x00, 0xF0, 0xFF, 0x3F, 0x00,
-	0xE0, 0xFF, 0x1F, 0x00, 0xC0, 0xFF, 0x0F, 0x00, }
+	0xC0, 0xE0, 0xF0, 0x78, 0x7C, 0x7E, 0xFF, 0xFF, 0x7F, 0x7F, 0x7F, 0x7F,
+	0x7F, 0xFF, 0xFF, 0x7F, 0x7F, 0x7F, 0xFF, 0xFF, 0x7E, 0x7C, 0x78, 0xF0,
+	0xE0, 0xC0, 0x3F, 0x7F, 0xEC, 0xDB, 0xDB, 0xDB, 0xE6, 0xFF, 0xFF, 0xFF,
+	0xC0, 0xFF, 0xFF, 0xFF, 0xE0, 0xDF, 0xDF, 0xDF, 0xE0, 0xFF, 0xC0, 0xFB,
+	0xFB, 0xFC, 0x7F, 0x3F, 0x00, 0x00, 0x00, 0x01, 0x03, 0x07, 0x0F, 0x0F,
+	0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x07, 0x03, 0x01, 0x00, 0x00, 0x00, }
 	};
 static bitmap_t PROGMEM train = { 26, 16, {
-	0x00, 0x00, 0xFF, 0x03, 0x7C, 0x00, 0xFF, 0x03, 0x38, 0x00, 0xF1, 0x01,
-	0x38, 0x00, 0xF1, 0x01, 0x38, 0x06, 0xF1, 0x01, 0x38, 0x0F, 0xFF, 0x01,
-	0xFC, 0xFF, 0xFF, 0x01, 0xFE, 0xFF, 0xFF, 0x01, 0xFF, 0xFF, 0xFF, 0x01,
-	0xFE, 0xFF, 0xFF, 0x01, 0xFC, 0xFF, 0xFF, 0x01, 0x38, 0xC7, 0x71, 0x00,
-	0xB8, 0xAA, 0xAA, 0x00, 0xB8, 0xEF, 0xFB, 0x00, 0x80, 0xAA, 0xAA, 0x00,
-	0x00, 0xC7, 0x71, 0x00, }
+	0x00, 0x80, 0xC2, 0xFE, 0xFE, 0xFE, 0xC2, 0xC0, 0xE0, 0xF0, 0xF0, 0xE0,
+	0xC0, 0xC0, 0xC0, 0xC0, 0xFF, 0xE3, 0xE3, 0xE3, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x03, 0x01, 0x03, 0x07, 0x3F, 0x3F, 0x3F, 0x07, 0x77, 0xAF, 0xFF,
+	0xAF, 0x77, 0x07, 0x77, 0xAF, 0xFF, 0xAF, 0x77, 0x07, 0x77, 0xAF, 0xFF,
+	0xAF, 0x77, 0x07, 0x00, }
 	};
 static bitmap_t PROGMEM train_f = { 26, 16, {
-	0xFF, 0x03, 0x00, 0x00, 0xFF, 0x03, 0xF8, 0x00, 0x3E, 0x02, 0x70, 0x00,
-	0x3E, 0x02, 0x70, 0x00, 0x3E, 0x82, 0x71, 0x00, 0xFE, 0xC3, 0x73, 0x00,
-	0xFE, 0xFF, 0xFF, 0x00, 0xFE, 0xFF, 0xFF, 0x01, 0xFE, 0xFF, 0xFF, 0x03,
-	0xFE, 0xFF, 0xFF, 0x01, 0xFE, 0xFF, 0xFF, 0x00, 0x38, 0x8E, 0x73, 0x00,
-	0x54, 0x55, 0x75, 0x00, 0x7C, 0xDF, 0x77, 0x00, 0x54, 0x55, 0x05, 0x00,
-	0x38, 0x8E, 0x03, 0x00, }
+	0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xE3, 0xE3, 0xE3, 0xFF, 0xC0, 0xC0,
+	0xC0, 0xC0, 0xE0, 0xF0, 0xF0, 0xE0, 0xC0, 0xC2, 0xFE, 0xFE, 0xFE, 0xC2,
+	0x80, 0x00, 0x00, 0x07, 0x77, 0xAF, 0xFF, 0xAF, 0x77, 0x07, 0x77, 0xAF,
+	0xFF, 0xAF, 0x77, 0x07, 0x77, 0xAF, 0xFF, 0xAF, 0x77, 0x07, 0x3F, 0x3F,
+	0x3F, 0x07, 0x03, 0x01, }
 	};
 static bitmap_t PROGMEM turnout_s = { 27, 20, {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF, 0xFF, 0x07,
-	0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF, 0xFF, 0x07,
-	0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF, 0xFF, 0x07, }
+	0x00, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+	0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+	0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, }
 	};
 static bitmap_t PROGMEM turnout_t = { 27, 20, {
-	0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x7C, 0x00,
-	0x00, 0x00, 0xFE, 0x00, 0x00, 0x00, 0xFF, 0x01, 0x00, 0x80, 0xFF, 0x01,
-	0x00, 0xC0, 0xFF, 0x00, 0x00, 0xE0, 0x7F, 0x00, 0x00, 0xF0, 0x3F, 0x00,
-	0x00, 0xFC, 0x1F, 0x00, 0x80, 0xFF, 0x0F, 0x00, 0xF8, 0xFF, 0x07, 0x00,
-	0xFF, 0xFF, 0x03, 0x00, 0xFF, 0xFF, 0x01, 0x00, 0xFF, 0xFF, 0x00, 0x00,
-	0xFF, 0x7F, 0x00, 0x00, 0xFF, 0x1F, 0x00, 0x00, 0xFF, 0x07, 0x00, 0x00,
-	0xFF, 0x01, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, }
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE, 0xFF, 0xFE, 0xFC, 0x78,
+	0x30, 0x00, 0x00, 0xF0, 0xF0, 0xF0, 0xF8, 0xF8, 0xF8, 0xF8, 0xFC, 0xFC,
+	0xFC, 0xFE, 0xFE, 0xFF, 0xFF, 0xFF, 0x7F, 0x3F, 0x1F, 0x0F, 0x07, 0x03,
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x07, 0x07, 0x07, 0x03, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, }
 	};
@@ -24,7 +24,7 @@
 #define _WIN32_WINNT 0x0500
 #include<windows.h>
 extern void SetImgPixel(unsigned int x, unsigned int y, unsigned char color);
-#elif defined(ESP8266)
+#elif defined(ESP8266) || defined(HOST_BUILD)
 #include "ssd1306.h"
 #include "callback.h"
 #endif
@@ -69,13 +69,20 @@ extern void SetImgPixel(unsigned int x, unsigned int y, unsigned char color);
 #define BOTTOM_LINE_Y   53
 #define BOTTOM_STR_LEN  20
 
+/* Images and fonts are blitted into the display buffer by whole byte columns.
+ * The per-pixel path is the reference implementation, used by the Windows
+ * build and selectable with LCD_PIXEL_RENDER */
+#if (defined(ESP8266) || defined(HOST_BUILD)) && !defined(LCD_PIXEL_RENDER)
+#define LCD_BLIT
+#endif
+
 #ifdef _WIN32
 #define X_SHIFT     0
 #define Y_SHIFT     30
 static HDC mydc;
 static COLORREF white = RGB(255,255,255);
 static COLORREF black = RGB(0,0,0);
-#elif defined(ESP8266)
+#elif defined(ESP8266) || defined(HOST_BUILD)
 #define X_SHIFT     0
 #define Y_SHIFT     0
 #define COLORREF SSD1306_COLOR
@@ -83,12 +90,49 @@ static SSD1306_COLOR white = OLED_WHITE;
 static SSD1306_COLOR black = OLED_BLACK;
 #endif
 
-#ifdef ESP8266
-static callback_handler_t stop_blink_timer, signal_blink_timer, mode_blink_timer, bat_blink_timer, scroll_timer;
-static bool stop_blink_state, signal_blink_state, mode_blink_state, bat_blink_state;
+#if defined(ESP8266) || defined(HOST_BUILD)
+#define BLINK_PERIOD        500
+#define BLINK_IMAGES_MAX    2
+
+/* Blinking icon: the images are drawn in the on phase and cleared in the off
+ * phase, together with the region if it is not empty */
+typedef struct {
+    bitmap_t *img;
+    uint8_t x, y;
+} blink_image_t;
+
+typedef struct {
+    uint8_t x, y, w, h;
+} blink_region_t;
+
+typedef struct {
+    bool active;
+    uint8_t count;
+    blink_image_t images[BLINK_IMAGES_MAX];
+    blink_region_t clr;
+} blink_t;
+
+typedef enum {
+    BLINK_STOP,
+    BLINK_SIGNAL,
+    BLINK_MODE,
+    BLINK_NUM
+} blink_id_t;
+
+static callback_handler_t blink_timer, scroll_timer;
+static blink_t blinks[BLINK_NUM];
+static bool blink_phase;
 #endif
 static bool last_mode, last_mode_left;
 static bool isUpdating = false;
+#if defined(ESP8266) || defined(HOST_BUILD)
+#define FRAME_PERIOD    (1000 / LCD_FRAME_RATE)
+static callback_handler_t frame_timer;
+static bool frame_dirty, frame_pending;
+static uint32_t frame_last, fps_start;
+static uint16_t fps_frames;
+#endif
+static lcd_frame_stats_t frame_stats;
 static uint8_t main_string_pos, main_string_len;
 static char main_string[32];
 
@@ -101,62 +145,46 @@ static inline void set_pixel(unsigned int x, unsigned int y, COLORREF color)
         }
     }
     SetImgPixel(x, y, (color == white) ? 255 : 0);
-#elif defined(ESP8266)
+#elif defined(ESP8266) || defined(HOST_BUILD)
   ssd1306_DrawPixel(X_SHIFT+x, Y_SHIFT+y, color);
 #endif
 }
 
+/* Images and fonts are page-major: bit (y%8) of data[(y/8)*width + x] */
+static inline bool bitmap_pixel(const uint8_t *data, uint8_t width, uint8_t x, uint8_t y)
+{
+    return (data[(y/8)*width + x] >> (y%8)) & 1;
+}
+
 static void dwaw_image(bitmap_t *img, uint8_t x, uint8_t y, bool inverse)
 {
-    uint8_t byte_step, bitmask;
-    uint16_t byte_id;
     if (!img) return;
 
+#ifdef LCD_BLIT
+    ssd1306_Blit(x, y, img->width, img->height, img->data, (!inverse) ? BLIT_SET : BLIT_CLEAR);
+#else
     COLORREF color_on = (!inverse) ? white : black;
 
-    byte_step = (img->width-1)/8 + 1;
-    for (uint8_t j=y; j<y+img->height; j++) {
-        byte_id = (j-y)*byte_step;
-        bitmask = 1;
+    for (uint8_t j=0; j<img->height; j++) {
         for (uint8_t i=0; i<img->width; i++) {
-            //set_pixel(x+i, j, ((img->data[byte_id] & bitmask) != 0) ? color_on : color_off);
-            if ((img->data[byte_id] & bitmask) != 0) set_pixel(x+i, j, color_on);
-            if ((i&0x7) != 0x7) {
-                bitmask<<=1;
-            } else {
-                byte_id++;
-                bitmask = 1;
-            }
+            if (bitmap_pixel(img->data, img->width, i, j)) set_pixel(x+i, y+j, color_on);
         }
     }
+#endif
 }
 
 static void dwaw_image_clr(bitmap_t *img, uint8_t x, uint8_t y, bool inverse)
 {
-    uint8_t byte_step, byte_id, bitmask;
     if (!img) return;
 
+#ifdef LCD_BLIT
+    ssd1306_Blit(x, y, img->width, img->height, img->data, (inverse) ? BLIT_SET : BLIT_CLEAR);
+#else
     COLORREF color_off = (inverse) ? white : black;
 
-#if 0
-    for (uint8_t j=y; j<y+img->height; j++) {
-        for (uint8_t i=x; i<x+img->width; i++) {
-            set_pixel(i, j, color_off);
-        }
-    }
-#else
-    byte_step = (img->width-1)/8 + 1;
-    for (uint8_t j=y; j<y+img->height; j++) {
-        byte_id = (j-y)*byte_step;
-        bitmask = 1;
+    for (uint8_t j=0; j<img->height; j++) {
         for (uint8_t i=0; i<img->width; i++) {
-            if ((img->data[byte_id] & bitmask) != 0) set_pixel(x+i, j, color_off);
-            if ((i&0x7) != 0x7) {
-                bitmask<<=1;
-            } else {
-                byte_id++;
-                bitmask = 1;
-            }
+            if (bitmap_pixel(img->data, img->width, i, j)) set_pixel(x+i, y+j, color_off);
         }
     }
 #endif
@@ -172,28 +200,22 @@ void draw_setpos(uint8_t x, uint8_t y)
 void draw_char(char ch, font_t *font, bool inverse)
 {
     if (!font) return;
-  	uint32_t byte;
-  	uint16_t *data = (uint16_t*)font->data;
-  	COLORREF color_on = (!inverse) ? white : black;
-  	COLORREF color_off = (!inverse) ? black : white;
-
-  	if (font == &font_16x26) {
-          for (uint8_t j = 0; j < font->height; j++) {
-              byte = data[(ch - 32) * font->height + j];
-              for (uint8_t i = 0; i < font->width; i++) {
-                  set_pixel(current_x + i, current_y + j, ((byte << i) & 0x8000) ? color_on : color_off);
-              }
-          }
-  	} else {
-          for (uint8_t i = 0; i < font->width; i++) {
-              for (uint8_t j = 0; j < font->height; j++) {
-                  byte = font->data[(ch - 32) * font->width  + i];
-                  set_pixel(current_x + i, current_y + j, (byte & (1<<j)) ? color_on : color_off);
-              }
-          }
-          current_x++;
-  	}
-  	current_x += font->width;
+    const uint8_t *glyph = &font->data[(ch - 32) * font->width * ((font->height + 7) / 8)];
+
+#ifdef LCD_BLIT
+    ssd1306_Blit(current_x, current_y, font->width, font->height, glyph, (!inverse) ? BLIT_COPY : BLIT_COPY_INV);
+#else
+    COLORREF color_on = (!inverse) ? white : black;
+    COLORREF color_off = (!inverse) ? black : white;
+
+    for (uint8_t j = 0; j < font->height; j++) {
+        for (uint8_t i = 0; i < font->width; i++) {
+            set_pixel(current_x + i, current_y + j, bitmap_pixel(glyph, font->width, i, j) ? color_on : color_off);
+        }
+    }
+#endif
+    if (font != &font_16x26) current_x++;
+    current_x += font->width;
 }
 
 void draw_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool state)
@@ -240,14 +262,103 @@ void draw_hline(uint8_t x, uint8_t y, uint8_t l, bool state)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
+#if defined(ESP8266) || defined(HOST_BUILD)
+static void fps_update(uint32_t now)
+{
+    if (now - fps_start >= 1000) {
+        frame_stats.fps = fps_frames * 1000UL / (now - fps_start);
+        fps_frames = 0;
+        fps_start = now;
+    }
+}
+
+static void frame_send(void)
+{
+    frame_dirty = false;
+    ssd1306_UpdateScreen();
+    frame_last = millis();
+    frame_stats.frames++;
+    fps_frames++;
+    fps_update(frame_last);
+}
+
+static void frame_handler(void *arg)
+{
+    frame_pending = false;
+    if (frame_dirty) frame_send();
+}
+#endif
+
+/* Mark the frame dirty, it is sent at most once per FRAME_PERIOD by the frame
+ * timer, so updates from several handlers in the same period share one frame */
 static void lcd_update(void)
 {
-    if (!isUpdating) {
-#ifdef ESP8266
-        ssd1306_UpdateScreen();
+    if (isUpdating) return;
+    frame_stats.requests++;
+#if defined(ESP8266) || defined(HOST_BUILD)
+    if (frame_dirty) {
+        frame_stats.coalesced++;
+        return;
+    }
+    frame_dirty = true;
+    if (!frame_pending) {
+        uint32_t elapsed = millis() - frame_last;
+        frame_pending = true;
+        callback_timer_start(frame_timer, (elapsed < FRAME_PERIOD) ? FRAME_PERIOD - elapsed : 1, false, frame_handler, NULL);
+    }
 #endif
+}
+
+#if defined(ESP8266) || defined(HOST_BUILD)
+/* One phase clock for all blinking icons, so they change together in one frame */
+static void blink_handler(void * arg)
+{
+    bool active = false;
+
+    blink_phase = !blink_phase;
+    for (uint8_t id=0; id<BLINK_NUM; id++) {
+        blink_t *blink = &blinks[id];
+        if (!blink->active) continue;
+        active = true;
+        if (!blink_phase && blink->clr.w) {
+            draw_fill(blink->clr.x, blink->clr.y, blink->clr.w, blink->clr.h, false);
+        }
+        for (uint8_t i=0; i<blink->count; i++) {
+            blink_image_t *image = &blink->images[i];
+            if (blink_phase) dwaw_image(image->img, image->x, image->y, false);
+            else if (!blink->clr.w) dwaw_image_clr(image->img, image->x, image->y, false);
+        }
     }
+    if (active) lcd_update();
+    else callback_timer_stop(blink_timer);
+}
+
+/* Register a blinking icon, the caller has drawn it in the on state */
+static void blink_start(blink_id_t id, const blink_image_t *images, uint8_t count, const blink_region_t *clr)
+{
+    blink_t *blink = &blinks[id];
+    bool running = false;
+
+    for (uint8_t i=0; i<BLINK_NUM; i++) running |= blinks[i].active;
+    if (count > BLINK_IMAGES_MAX) count = BLINK_IMAGES_MAX;
+    memcpy(blink->images, images, count * sizeof(blink_image_t));
+    blink->count = count;
+    if (clr) blink->clr = *clr;
+    else memset(&blink->clr, 0, sizeof(blink->clr));
+    blink->active = true;
+    if (!running) {
+        if (!blink_timer) blink_timer = callback_timer_create();
+        blink_phase = true;
+        callback_timer_start(blink_timer, BLINK_PERIOD, true, blink_handler, NULL);
+    }
+}
+
+/* Unregister a blinking icon, the caller draws its final state */
+static void blink_stop(blink_id_t id)
+{
+    blinks[id].active = false;
 }
+#endif
 
 static void align(const char* in, char *out, alignment_t aligment, uint8_t len)
 {
@@ -291,7 +402,7 @@ static inline void lcd_print(uint8_t x, uint8_t y, const char* str, uint8_t blin
     lcd_update();
 }
 
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
 static void scroll_handler(void * arg)
 {
   if (!main_string_pos) callback_timer_start(scroll_timer, 500, true, scroll_handler, NULL);
@@ -310,7 +421,7 @@ void lcd_main_print(const char* str, uint8_t blink_pos, alignment_t aligment)
       strncpy(main_string, str, sizeof(main_string));
       main_string[main_string_len++] = ' ';
       main_string_pos = 0;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
       if (!scroll_timer) scroll_timer = callback_timer_create();
       callback_timer_start(scroll_timer, 2000, false, scroll_handler, NULL);
     } else callback_timer_stop(scroll_timer);
@@ -328,28 +439,17 @@ void lcd_bottom_print(const char* str, alignment_t aligment)
     }else lcd_print(BOTTOM_LINE_X, BOTTOM_LINE_Y, str, 0, aligment, &font_5x7, BOTTOM_STR_LEN);
 }
 
-#ifdef ESP8266
-static void stop_blink_handler(void * arg)
-{
-  if (stop_blink_state) dwaw_image_clr(&stop, STOP_X, STOP_Y, false);
-  else dwaw_image(&stop, STOP_X, STOP_Y, false);
-  stop_blink_state = !stop_blink_state;
-  lcd_update();
-}
-#endif
-
 void lcd_set_stop(bool state)
 {
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
     if (state) {
-      if (!stop_blink_timer) stop_blink_timer = callback_timer_create();
-      callback_timer_start(stop_blink_timer, 500, true, stop_blink_handler, NULL);
+      static const blink_image_t images[] = {{&stop, STOP_X, STOP_Y}};
       dwaw_image(&stop, STOP_X, STOP_Y, false);
-      stop_blink_state = true;
+      blink_start(BLINK_STOP, images, 1, NULL);
     }
     else {
+      blink_stop(BLINK_STOP);
       dwaw_image_clr(&stop, STOP_X, STOP_Y, false);
-      callback_timer_stop(stop_blink_timer);
     }
 #else
     if (state) dwaw_image(&stop, STOP_X, STOP_Y, false);
@@ -417,16 +517,6 @@ void lcd_set_battery(uint8_t level, bool state)
     lcd_update();
 }
 
-#ifdef ESP8266
-static void signal_blink_handler(void * arg)
-{
-  if (signal_blink_state) dwaw_image_clr(&ant, ANT_X, ANT_Y, false);
-  else dwaw_image(&ant, ANT_X, ANT_Y, false);
-  signal_blink_state = !signal_blink_state;
-  lcd_update();
-}
-#endif
-
 void lcd_set_signal(uint8_t level, bool state)
 {
     static const uint8_t line_len[3] = {4, 7, 9};
@@ -439,20 +529,19 @@ void lcd_set_signal(uint8_t level, bool state)
         for (uint8_t i=0; i<LCD_SIG_MAX_VAL; i++) {
             draw_rect(ANT_X+3-line_len[i], ANT_Y+18-i*4, line_len[i], 2, (i<level) ? true : false);
         }
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
         if (level == 0) {
-          if (!signal_blink_timer) signal_blink_timer = callback_timer_create();
-          callback_timer_start(signal_blink_timer, 500, true, signal_blink_handler, NULL);
-          signal_blink_state = true;
+          static const blink_image_t images[] = {{&ant, ANT_X, ANT_Y}};
+          blink_start(BLINK_SIGNAL, images, 1, NULL);
         }
         else {
-          callback_timer_stop(signal_blink_timer);
+          blink_stop(BLINK_SIGNAL);
           dwaw_image(&ant, ANT_X, ANT_Y, false);
         }
 #endif
     } else {
-#ifdef ESP8266
-        callback_timer_stop(signal_blink_timer);
+#if defined(ESP8266) || defined(HOST_BUILD)
+        blink_stop(BLINK_SIGNAL);
 #endif
         dwaw_image_clr(&ant, ANT_X, ANT_Y, false);
         for (uint8_t i=0; i<3; i++) {
@@ -553,24 +642,6 @@ void lcd_set_shift(bool state, bool filled)
     lcd_update();
 }
 
-#ifdef ESP8266
-static void mode_blink_handler(void * arg)
-{
-  if (mode_blink_state) {
-      if (last_mode) {
-          dwaw_image((last_mode_left)? &train : &train_f, TRAIN_X, TRAIN_Y, false);
-          dwaw_image((last_mode_left)? &smoke : &smoke_f, SMOKE_X, SMOKE_Y, false);
-      } else {
-          dwaw_image((last_mode_left)? &turnout_t : &turnout_s, TURNOUT_X, TURNOUT_Y, false);
-      }
-    } else {
-        draw_fill(MODE_CLR_X, MODE_CLR_Y, MODE_CLR_W, MODE_CLR_H, false);
-    }
-  mode_blink_state = !mode_blink_state;
-  lcd_update();
-}
-#endif
-
 void lcd_set_mode(bool train_mode, bool left, bool blink, bool state)
 {
     static bool last_mode_state;
@@ -587,13 +658,17 @@ void lcd_set_mode(bool train_mode, bool left, bool blink, bool state)
     } else {
         draw_fill(MODE_CLR_X, MODE_CLR_Y, MODE_CLR_W, MODE_CLR_H, false);
     }
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
     if (blink && state) {
-      if (!mode_blink_timer) mode_blink_timer = callback_timer_create();
-      callback_timer_start(mode_blink_timer, 500, true, mode_blink_handler, NULL);
-      mode_blink_state = true;
+      static const blink_region_t region = {MODE_CLR_X, MODE_CLR_Y, MODE_CLR_W, MODE_CLR_H};
+      blink_image_t images[BLINK_IMAGES_MAX] = {
+        {(left)? &train : &train_f, TRAIN_X, TRAIN_Y},
+        {(left)? &smoke : &smoke_f, SMOKE_X, SMOKE_Y},
+      };
+      if (!train_mode) images[0] = (blink_image_t){(left)? &turnout_t : &turnout_s, TURNOUT_X, TURNOUT_Y};
+      blink_start(BLINK_MODE, images, (train_mode) ? 2 : 1, &region);
     }
-    else callback_timer_stop(mode_blink_timer);
+    else blink_stop(BLINK_MODE);
 #endif
 
     last_mode_state = state;
@@ -604,7 +679,7 @@ void lcd_set_mode(bool train_mode, bool left, bool blink, bool state)
 
 void lcd_clear(void)
 {
-#if defined(ESP8266)
+#if defined(ESP8266) || defined(HOST_BUILD)
     ssd1306_Fill(OLED_BLACK);
     lcd_update();
 #endif
@@ -628,13 +703,35 @@ void lcd_commit(void)
     lcd_update();
 }
 
+/* Send the pending frame now and wait for the transfer, for callers which
+ * stop the timers and the main loop afterwards */
+void lcd_flush(void)
+{
+#if defined(ESP8266) || defined(HOST_BUILD)
+    callback_timer_stop(frame_timer);
+    frame_pending = false;
+    frame_send();
+    while (ssd1306_Process());
+#endif
+}
+
+void lcd_get_frame_stats(lcd_frame_stats_t *stats)
+{
+    if (!stats) return;
+#if defined(ESP8266) || defined(HOST_BUILD)
+    fps_update(millis());
+#endif
+    *stats = frame_stats;
+}
+
 bool lcd_init(uint8_t contrast)
 {
 #ifdef _WIN32
     HWND myconsole = GetConsoleWindow();
     mydc = GetDC(myconsole);
     draw_rect(0, 0, 128+1, 64+1, true);
-#elif defined(ESP8266)
+#elif defined(ESP8266) || defined(HOST_BUILD)
+    if (!frame_timer) frame_timer = callback_timer_create();
     if (!ssd1306_Init(contrast)) return false;
 #endif
 
@@ -27,6 +27,13 @@
 extern "C" {
 #endif
 
+typedef struct {
+    uint32_t requests;      //lcd updates requested
+    uint32_t frames;        //frames sent to the display
+    uint32_t coalesced;     //requests merged into an already pending frame
+    uint16_t fps;           //frames sent during the last second
+} lcd_frame_stats_t;
+
 typedef enum {
     ALIGN_NONE,
     ALIGN_CENTER,
@@ -52,6 +59,8 @@ bool lcd_init(uint8_t contrast);
 void lcd_begin(void);
 void lcd_commit(void);
 void lcd_clear(void);
+void lcd_flush(void);
+void lcd_get_frame_stats(lcd_frame_stats_t *stats);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,454 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "loco_lib.h"
+#include "flash_region.h"
+#include "config.h"
+#include "crc16.h"
+#include "log.h"
+
+/* Record of an entry in the flash region, erased bytes read as 0xFF. A
+ * record is deleted by clearing valid, which needs no erase. */
+typedef struct {
+    loco_t loco;
+    uint8_t valid;
+    uint8_t reserved[3];
+    uint16_t crc;
+} loco_rec_t;
+#define REC_VALID       0xA5
+#define REC_DELETED     0x00
+#define REC_ERASED      0xFF
+#define RECS_PER_PAGE   (LOCO_LIB_PAGE / sizeof(loco_rec_t))
+#define RECS_PER_SECTOR (FLASH_REGION_SECTOR / sizeof(loco_rec_t))
+#define PAGE_NONE       0xFFFF
+
+/* A record sector is only erased while its new content is in the copy
+ * sector. The journal sector holds an entry for every such rewrite, written
+ * after the copy and marked done once the sector is written again, so an
+ * entry which is not done is finished from the copy at boot. Both follow
+ * the record sectors at the end of the region. */
+typedef struct {
+    uint8_t valid;
+    uint8_t reserved;
+    uint16_t sector;        // record sector rewritten from the copy
+    uint16_t drop;          // record deleted after it, LOCO_LIB_NONE if none
+    uint16_t copy_crc;      // of the copy sector
+    uint8_t reserved2[4];
+    uint16_t crc;           // of the fields above
+    uint8_t done;           // cleared once the record sector is written
+    uint8_t reserved3;
+} journal_t;
+#define JOURNAL_LEN     (FLASH_REGION_SECTOR / sizeof(journal_t))
+#define JOURNAL_NONE    0xFFFF
+
+typedef struct {
+    uint16_t addr;
+    uint16_t id;
+} index_t;
+
+typedef struct {
+    uint16_t page;
+    uint32_t used;
+    uint8_t data[LOCO_LIB_PAGE];
+} cache_page_t;
+
+static index_t lib_index[LOCO_LIB_LEN];  //sorted by the address
+static uint16_t count;
+static uint16_t used;           //records up to here may be programmed
+static uint16_t capacity;
+static uint32_t copy_sector, journal_sector;
+static uint16_t journal_next;
+static cache_page_t cache[LOCO_LIB_CACHE];
+static uint32_t cache_clock;
+static loco_lib_stats_t stats;
+static bool read_only;          //entries kept in the pinned cache pages
+
+static uint16_t rec_crc(const loco_rec_t *rec)
+{
+    return crc16(rec, offsetof(loco_rec_t, crc), CRC16_INIT);
+}
+
+static bool rec_ok(const loco_rec_t *rec)
+{
+    return (rec->valid == REC_VALID) && (rec_crc(rec) == rec->crc);
+}
+
+static bool erased(const void *buf, uint32_t len)
+{
+    const uint8_t *data = (const uint8_t*)buf;
+    while (len--) {
+        if (*data++ != REC_ERASED) return false;
+    }
+    return true;
+}
+
+/* Only clears bits, so it is programmed without an erase */
+static bool programmable(const void *old, const void *buf, uint32_t len)
+{
+    const uint8_t *prev = (const uint8_t*)old, *data = (const uint8_t*)buf;
+    while (len--) {
+        if ((*prev++ & *data) != *data) return false;
+        data++;
+    }
+    return true;
+}
+
+static void cache_reset(void)
+{
+    for (uint8_t i=0; i<LOCO_LIB_CACHE; i++) {
+        cache[i].page = PAGE_NONE;
+        cache[i].used = 0;
+    }
+}
+
+/* The record through the page cache, the least recently used page is
+ * replaced on a miss */
+static const loco_rec_t * cached(uint16_t id)
+{
+    uint16_t page = id / RECS_PER_PAGE;
+    uint8_t victim = 0;
+    uint32_t offset, len;
+
+    for (uint8_t i=0; i<LOCO_LIB_CACHE; i++) {
+        if (cache[i].page == page) {
+            cache[i].used = ++cache_clock;
+            stats.hits++;
+            return (const loco_rec_t*)&cache[i].data[(id % RECS_PER_PAGE) * sizeof(loco_rec_t)];
+        }
+        if (cache[i].used < cache[victim].used) victim = i;
+    }
+    stats.misses++;
+    offset = (uint32_t)page * LOCO_LIB_PAGE;
+    len = (flash_region_size() - offset < LOCO_LIB_PAGE) ? flash_region_size() - offset : LOCO_LIB_PAGE;
+    memset(cache[victim].data, REC_ERASED, LOCO_LIB_PAGE);
+    if (!flash_region_read(offset, cache[victim].data, len)) {
+        cache[victim].page = PAGE_NONE;
+        cache[victim].used = 0;
+        return NULL;
+    }
+    cache[victim].page = page;
+    cache[victim].used = ++cache_clock;
+    return (const loco_rec_t*)&cache[victim].data[(id % RECS_PER_PAGE) * sizeof(loco_rec_t)];
+}
+
+/* The cached pages follow every write of the record sectors */
+static bool region_write(uint32_t offset, const void *buf, uint32_t len)
+{
+    for (uint8_t i=0; i<LOCO_LIB_CACHE; i++) {
+        uint32_t start = (uint32_t)cache[i].page * LOCO_LIB_PAGE;
+        uint32_t from = (start > offset) ? start : offset;
+        uint32_t to = (start + LOCO_LIB_PAGE < offset + len) ? start + LOCO_LIB_PAGE : offset + len;
+        if ((cache[i].page == PAGE_NONE) || (from >= to)) continue;
+        memcpy(&cache[i].data[from - start], (const uint8_t*)buf + (from - offset), to - from);
+    }
+    return flash_region_write(offset, buf, len);
+}
+
+static bool drop_rec(uint16_t id)
+{
+    uint8_t deleted = REC_DELETED;
+    return region_write((uint32_t)id * sizeof(loco_rec_t) + offsetof(loco_rec_t, valid), &deleted, sizeof(deleted));
+}
+
+/* Write the record sector of the entry from the copy and drop the record
+ * the entry names, then mark it done. Repeated at boot if cut off. */
+static bool journal_apply(uint16_t slot, const journal_t *entry, const uint8_t *sector)
+{
+    uint8_t done = 0;
+    bool ret = region_write((uint32_t)entry->sector * FLASH_REGION_SECTOR, sector, FLASH_REGION_SECTOR);
+    if (ret && (entry->drop != LOCO_LIB_NONE)) ret = drop_rec(entry->drop);
+    return ret && flash_region_write(journal_sector + slot * sizeof(journal_t) + offsetof(journal_t, done), &done, sizeof(done));
+}
+
+/* Rewrite the sector of the record through the copy sector. drop: record
+ * deleted with it, so moving an entry is one step. */
+static bool rewrite_rec(uint16_t id, const loco_rec_t *rec, uint16_t drop)
+{
+    uint32_t base = (uint32_t)(id / RECS_PER_SECTOR) * FLASH_REGION_SECTOR;
+    uint8_t *sector;
+    journal_t entry;
+    uint16_t slot;
+    bool ret;
+
+    sector = (uint8_t*)malloc(FLASH_REGION_SECTOR);
+    if (!sector) {
+        LOG_ERR("No memory for the flash sector\n\r");
+        return false;
+    }
+    ret = flash_region_read(base, sector, FLASH_REGION_SECTOR);
+    memcpy(&sector[(id % RECS_PER_SECTOR) * sizeof(loco_rec_t)], rec, sizeof(loco_rec_t));
+    //the previous entry is done, so the copy and a full journal may be erased
+    ret = ret && flash_region_write(copy_sector, sector, FLASH_REGION_SECTOR);
+    if (ret && (journal_next >= JOURNAL_LEN)) {
+        ret = flash_region_erase(journal_sector, FLASH_REGION_SECTOR);
+        journal_next = 0;
+    }
+    memset(&entry, REC_ERASED, sizeof(entry));
+    entry.valid = REC_VALID;
+    entry.sector = base / FLASH_REGION_SECTOR;
+    entry.drop = drop;
+    entry.copy_crc = crc16(sector, FLASH_REGION_SECTOR, CRC16_INIT);
+    entry.crc = crc16(&entry, offsetof(journal_t, crc), CRC16_INIT);
+    slot = journal_next++;
+    ret = ret && flash_region_write(journal_sector + slot * sizeof(journal_t), &entry, sizeof(entry));
+    ret = ret && journal_apply(slot, &entry, sector);
+    free(sector);
+    stats.rewrites++;
+    return ret;
+}
+
+/* Programmed in place when it only clears bits, the sector is rewritten
+ * otherwise. drop: record deleted in the same step. */
+static bool write_rec(uint16_t id, const loco_t *loco, uint16_t drop)
+{
+    const loco_rec_t *old = cached(id);
+    loco_rec_t rec;
+
+    if (!old) return false;
+    memset(&rec, 0, sizeof(rec));
+    rec.loco = *loco;
+    rec.loco.name[LOCO_NAME_LEN] = '\0';
+    rec.valid = REC_VALID;
+    rec.crc = rec_crc(&rec);
+    stats.writes++;
+    if (id >= used) used = id + 1;
+    if (programmable(old, &rec, sizeof(rec)) && (drop == LOCO_LIB_NONE))
+        return region_write((uint32_t)id * sizeof(rec), &rec, sizeof(rec));
+    return rewrite_rec(id, &rec, drop);
+}
+
+/* The last journal entry, if not done, is finished from the copy */
+static void journal_recover(void)
+{
+    uint16_t pending = JOURNAL_NONE;
+    journal_t entry, last;
+    uint8_t *sector;
+
+    for (journal_next = 0; journal_next < JOURNAL_LEN; journal_next++) {
+        if (!flash_region_read(journal_sector + journal_next * sizeof(entry), &entry, sizeof(entry)) ||
+            erased(&entry, sizeof(entry))) break;
+        pending = JOURNAL_NONE;
+        if ((entry.valid == REC_VALID) && (entry.crc == crc16(&entry, offsetof(journal_t, crc), CRC16_INIT)) &&
+            (entry.done == REC_ERASED) && ((uint32_t)entry.sector * FLASH_REGION_SECTOR < copy_sector)) {
+            pending = journal_next;
+            last = entry;
+        }
+    }
+    if (pending == JOURNAL_NONE) return;
+    sector = (uint8_t*)malloc(FLASH_REGION_SECTOR);
+    if (!sector) {
+        LOG_ERR("No memory for the flash sector\n\r");
+        return;
+    }
+    if (flash_region_read(copy_sector, sector, FLASH_REGION_SECTOR) &&
+        (crc16(sector, FLASH_REGION_SECTOR, CRC16_INIT) == last.copy_crc)) {
+        LOG_INFO("Loco library write finished from the copy\n\r");
+        journal_apply(pending, &last, sector);
+    } else LOG_ERR("Loco library copy damaged\n\r");
+    free(sector);
+}
+
+static int index_cmp(const void *a, const void *b)
+{
+    return (int)((const index_t*)a)->addr - (int)((const index_t*)b)->addr;
+}
+
+/* First of the n index entries with an address not below addr */
+static uint16_t index_lower(uint16_t n, uint16_t addr)
+{
+    uint16_t low = 0, high = n;
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (lib_index[mid].addr < addr) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static void index_insert(uint16_t n, uint16_t addr, uint16_t id)
+{
+    uint16_t pos = index_lower(n, addr);
+    memmove(&lib_index[pos+1], &lib_index[pos], (n - pos) * sizeof(index_t));
+    lib_index[pos].addr = addr;
+    lib_index[pos].id = id;
+}
+
+static void index_remove(uint16_t n, uint16_t addr)
+{
+    uint16_t pos = index_lower(n, addr);
+    if ((pos < n) && (lib_index[pos].addr == addr))
+        memmove(&lib_index[pos], &lib_index[pos+1], (n - pos - 1) * sizeof(index_t));
+}
+
+/* Read the records up to the first erased one and sort the index. The last
+ * entry takes the place of a damaged one, as on a delete. */
+void loco_lib_init(void)
+{
+    uint32_t sectors = flash_region_size() / FLASH_REGION_SECTOR;
+    uint32_t recs = (sectors > 2) ? (sectors - 2) * RECS_PER_SECTOR : 0;
+    const loco_rec_t *rec;
+
+    capacity = (recs < LOCO_LIB_LEN) ? recs : LOCO_LIB_LEN;
+    copy_sector = (sectors - 2) * FLASH_REGION_SECTOR;
+    journal_sector = (sectors - 1) * FLASH_REGION_SECTOR;
+    cache_reset();
+    count = used = 0;
+    read_only = false;
+    if (!capacity) {
+        LOG_ERR("No flash region for the loco library\n\r");
+        return;
+    }
+    journal_recover();
+    while ((used < capacity) && (rec = cached(used)) && !erased(rec, sizeof(loco_rec_t))) used++;
+    while (count < used) {
+        loco_t last;
+        rec = cached(count);
+        if (rec && rec_ok(rec)) {
+            lib_index[count].addr = rec->loco.addr;
+            lib_index[count].id = count;
+            count++;
+            continue;
+        }
+        if (rec && (rec->valid != REC_DELETED)) LOG_ERR("Loco library record damaged\n\r");
+        while ((used > count + 1) && !((rec = cached(used - 1)) && rec_ok(rec))) used--;
+        if (used <= count + 1) break;
+        last = rec->loco;
+        if (!write_rec(count, &last, used - 1)) break;
+        used--;
+    }
+    qsort(lib_index, count, sizeof(index_t), index_cmp);
+}
+
+/* Without room in the flash region the entries of an old config page are
+ * kept in RAM instead: the cache pages are pinned to the first records and
+ * hold them, so get and find work as usual. Nothing is written from then on
+ * until the next loco_lib_init(). An address is only kept once. */
+bool loco_lib_keep(const loco_t *loco)
+{
+    loco_rec_t *rec;
+
+    if (!read_only) {
+        read_only = true;
+        count = used = 0;
+        for (uint8_t i=0; i<LOCO_LIB_CACHE; i++) {
+            cache[i].page = i;
+            cache[i].used = 0;
+            memset(cache[i].data, REC_ERASED, LOCO_LIB_PAGE);
+        }
+    }
+    if (loco_lib_find(loco->addr) != LOCO_LIB_NONE) return true;
+    if (count >= LOCO_LIB_CACHE * RECS_PER_PAGE) return false;
+    rec = (loco_rec_t*)&cache[count / RECS_PER_PAGE].data[(count % RECS_PER_PAGE) * sizeof(loco_rec_t)];
+    memset(rec, 0, sizeof(*rec));
+    rec->loco = *loco;
+    rec->loco.name[LOCO_NAME_LEN] = '\0';
+    rec->valid = REC_VALID;
+    rec->crc = rec_crc(rec);
+    index_insert(count, loco->addr, count);
+    count++;
+    return true;
+}
+
+bool loco_lib_read_only(void)
+{
+    return read_only;
+}
+
+uint16_t loco_lib_count(void)
+{
+    return count;
+}
+
+uint16_t loco_lib_capacity(void)
+{
+    return capacity;
+}
+
+bool loco_lib_get(uint16_t id, loco_t *loco)
+{
+    const loco_rec_t *rec;
+    if (id >= count) return false;
+    rec = cached(id);
+    if (!rec) return false;
+    *loco = rec->loco;
+    return true;
+}
+
+/* Returns the entry of the address or LOCO_LIB_NONE */
+uint16_t loco_lib_find(uint16_t addr)
+{
+    uint16_t pos = index_lower(count, addr);
+    return ((pos < count) && (lib_index[pos].addr == addr)) ? lib_index[pos].id : LOCO_LIB_NONE;
+}
+
+/* Appended as the last entry, an address is only kept once */
+bool loco_lib_add(const loco_t *loco)
+{
+    if (read_only || (count >= capacity) || (loco_lib_find(loco->addr) != LOCO_LIB_NONE)) return false;
+    if (!write_rec(count, loco, LOCO_LIB_NONE)) return false;
+    index_insert(count, loco->addr, count);
+    count++;
+    return true;
+}
+
+bool loco_lib_set(uint16_t id, const loco_t *loco)
+{
+    loco_t old;
+    uint16_t other = loco_lib_find(loco->addr);
+
+    if (read_only || !loco_lib_get(id, &old) || ((other != LOCO_LIB_NONE) && (other != id))) return false;
+    if (!write_rec(id, loco, LOCO_LIB_NONE)) return false;
+    if (old.addr != loco->addr) {
+        index_remove(count, old.addr);
+        index_insert(count - 1, loco->addr, id);
+    }
+    return true;
+}
+
+/* The last entry takes the place of the deleted one, so no other moves. Its
+ * old record is dropped in the same step. */
+bool loco_lib_delete(uint16_t id)
+{
+    loco_t deleted, last;
+    uint16_t last_id = count - 1;
+
+    if (read_only || !loco_lib_get(id, &deleted)) return false;
+    if (id != last_id) {
+        if (!loco_lib_get(last_id, &last) || !write_rec(id, &last, last_id)) return false;
+        lib_index[index_lower(count, last.addr)].id = id;
+    } else if (!drop_rec(last_id)) return false;
+    index_remove(count, deleted.addr);
+    count--;
+    return true;
+}
+
+bool loco_lib_clear(void)
+{
+    uint32_t len = (uint32_t)used * sizeof(loco_rec_t);
+    len = (len + FLASH_REGION_SECTOR - 1) & ~(FLASH_REGION_SECTOR - 1);
+    if (read_only) return false;
+    count = used = 0;
+    cache_reset();
+    return !len || flash_region_erase(0, len);
+}
+
+void loco_lib_get_stats(loco_lib_stats_t *out)
+{
+    *out = stats;
+}
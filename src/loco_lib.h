@@ -0,0 +1,63 @@
+/*
+ * This file is part of the WMouse distribution https://github.com/railbox/WMouse.
+ * Copyright (c) 2020 Anton Nadezhdin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LOCO_LIB_H
+#define LOCO_LIB_H
+
+/* Loco library in the flash region. The entries are kept back to back in
+ * fixed size records, so the menu position of a loco is its record number.
+ * A RAM index sorted by address finds the record of a loco, the records are
+ * read through a small LRU cache of pages. Changes are written through at
+ * once, deleting an entry moves the last one into its place. A sector is
+ * never erased while it holds the only copy of its records, a write cut off
+ * by a power loss is finished at the next loco_lib_init(). An old config
+ * page which does not fit is kept read-only by loco_lib_keep(). */
+#include <stdint.h>
+#include <stdbool.h>
+#include "main_page.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOCO_LIB_NONE   0xFFFF
+
+typedef struct
+{
+    uint32_t hits;          // records found in the page cache
+    uint32_t misses;        // pages read from the flash region
+    uint32_t writes;        // records written to the flash region
+    uint32_t rewrites;      // sectors rewritten through the copy sector
+} loco_lib_stats_t;
+
+void loco_lib_init(void);
+uint16_t loco_lib_count(void);
+uint16_t loco_lib_capacity(void);
+bool loco_lib_get(uint16_t id, loco_t *loco);
+uint16_t loco_lib_find(uint16_t addr);
+bool loco_lib_add(const loco_t *loco);
+bool loco_lib_set(uint16_t id, const loco_t *loco);
+bool loco_lib_delete(uint16_t id);
+bool loco_lib_clear(void);
+bool loco_lib_keep(const loco_t *loco);
+bool loco_lib_read_only(void);
+void loco_lib_get_stats(loco_lib_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,12 +24,14 @@
 #include "log.h"
 #include "z21client.h"
 #include "callback.h"
+#include "loco_lib.h"
 
 #define INC(x,low,high)    (((x)==high)?(low):((x)+1))
 #define DEC(x,low,high)    (((x)==low)?(high):((x)-1))
 #define DEFAULT_IDLE_TIME_M 5
 #define SET_IP(_arr, _x1, _x2, _x3, _x4) {_arr[0]=_x1;_arr[1]=_x2;_arr[2]=_x3;_arr[3]=_x4;}
 #define MAX_TURNOUT_ID      1023
+#define TURNOUT_PREFETCH    4       //turnout positions asked for from the shown one on
 #define PROG_TIMEOUT        5000
 
 static uint8_t U16ToStr(uint16_t val, char *str);
@@ -120,6 +122,7 @@ DECLARE_TEXT(text_lib_full, "LIB FULL", "BIBL. JEST PELNA");
 DECLARE_TEXT(text_exist, "LOCO EXIST", "LOCO JUZ ISTNIEJE");
 DECLARE_TEXT(text_value_err, "WRONG VALUE", "BLEDNA WARTOSC");
 DECLARE_TEXT(text_conn_fault, "CONNECTION ERR", "BLAD POLACZENIA");
+DECLARE_TEXT(text_no_fs, "NEEDS FLASH FS:1MB", "WYMAGA FLASH FS:1MB");
 
 static const uint8_t ss_val[3] = {14,28,128};
 static text_list_t ss_list[3] = {"14", "28", "128"};
@@ -131,7 +134,7 @@ static const seqitem_t seq_loco[] = {
         .len = 3,
         .name = text_name,
         .init_val = "",
-        .max_len = 6,
+        .max_len = LOCO_NAME_LEN,
         .type = EDIT_TEXT,
         .callback = callback_loco_name,
     },
@@ -402,10 +405,13 @@ const erritem_t err_conn_fault = {
     .id = 13,
     .name = text_conn_fault,
 };
+const erritem_t err_no_fs = {
+    .id = 14,
+    .name = text_no_fs,
+};
 
-//Dynamic loco list menu
-static const char * text_loconame[LOCO_LIST_LEN];
-mitem_t loco_list[LOCO_LIST_LEN];
+//Loco library menu, one item for all entries, see menu_ll.c
+mitem_t loco_list[1];
 
 static const mitem_t loco_menu[] = {
     {
@@ -562,6 +568,10 @@ const mitem_t menu_base[] = {
 static config_update_callback_t config_update_callback;
 config_db_t config_db;
 static loco_t loco_current;
+static loco_t loco_sel;     //library entry at loco_db_pos
+static loco_t loco_shown;   //library entry shown by the menu
+static loco_state_t loco_state[LOCO_STATE_LEN];
+static uint16_t loco_state_clock;
 static bool loco_choose;
 static uint8_t loco_func_shift;
 static prog_cv_t prog_cv;
@@ -574,7 +584,7 @@ typedef enum {
 static track_state_t track_state = TRACK_NORMAL;
 static page_t err_call_page;
 static uint8_t err_id;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
 static callback_handler_t prog_timeout_timer;
 #endif
 
@@ -589,7 +599,7 @@ void main_set_config_update_callback(config_update_callback_t callback)
     config_update_callback = callback;
 }
 
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
 static void prog_timeout_handler(void * arg)
 {
   main_show_error(&err_noresp);
@@ -608,7 +618,7 @@ static bool callback_cv(void * param, uint32_t flags, bool read)
             prog_cv.cv = atoi((char*)param);
             prog_cv.val = 0xFFFF;
             bool res = z21Client_requestReadCV(prog_cv.cv);
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
             callback_timer_start(prog_timeout_timer, PROG_TIMEOUT, false, prog_timeout_handler, 0);
 #endif
             /* Return false to stop sequence as we are waiting for command station response */
@@ -622,7 +632,7 @@ static bool callback_cv(void * param, uint32_t flags, bool read)
 static void cv_response_notification(uint16_t CV, uint8_t value)
 {
     uint16_t param = 0xDEAD;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
     callback_timer_stop(prog_timeout_timer);
 #endif
 
@@ -644,7 +654,7 @@ static bool callback_cv_value(void * param, uint32_t flags, bool read)
         if (magic_val != CV_MAGIC_VALUE) {
             prog_cv.val = atoi((char*)param);
             bool res = z21Client_setCV(prog_cv.cv, prog_cv.val);
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
             callback_timer_start(prog_timeout_timer, PROG_TIMEOUT, false, prog_timeout_handler, 0);
 #endif
             LOG_INFO_PRINTF("  Prog CV=%u val=%u", prog_cv.cv, prog_cv.val);
@@ -691,25 +701,71 @@ static bool callback_pom_cv_value(void * param, uint32_t flags, bool read)
     return false;
 }
 
-static bool check_addr(loco_t *item, int8_t id)
+/* Runtime state of the locos used lately. A loco not kept yet replaces the
+ * least recently used one. */
+static loco_state_t * loco_state_get(uint16_t addr)
+{
+    loco_state_t *oldest = &loco_state[0];
+    for (uint8_t i=0; i<LOCO_STATE_LEN; i++) {
+        if (loco_state[i].addr == addr) {
+            loco_state[i].used = ++loco_state_clock;
+            return &loco_state[i];
+        }
+        if ((uint16_t)(loco_state_clock - loco_state[i].used) > (uint16_t)(loco_state_clock - oldest->used))
+            oldest = &loco_state[i];
+    }
+    memset(oldest, 0, sizeof(loco_state_t));
+    oldest->addr = addr;
+    oldest->used = ++loco_state_clock;
+    return oldest;
+}
+
+static inline loco_state_t * loco_cur_state(void)
+{
+    return loco_state_get(loco_sel.addr);
+}
+
+/* Called whenever loco_db_pos or the library changes */
+static void loco_select(void)
+{
+    loco_list[0].len = loco_lib_count() ? 1 : 0;
+    if (config_db.loco_db_pos > loco_lib_count()) config_db.loco_db_pos = 0;
+    if (!loco_lib_get(config_db.loco_db_pos, &loco_sel)) memset(&loco_sel, 0, sizeof(loco_sel));
+}
+
+/* Called by menu_ll.c for loco_list */
+uint16_t LocoCount(void)
 {
-    for (uint8_t i=0; i<config_db.loco_db_len; i++) {
-      if ((config_db.loco_db[i].addr == item->addr) && (id != i)) {
+    return loco_lib_count();
+}
+
+const char * LocoName(uint16_t id)
+{
+    if (!loco_lib_get(id, &loco_shown)) loco_shown.name[0] = '\0';
+    return loco_shown.name;
+}
+
+static bool check_addr(loco_t *item, uint16_t id)
+{
+    uint16_t slot = loco_lib_find(item->addr);
+    if ((slot != LOCO_LIB_NONE) && (slot != id)) {
         main_show_error(&err_exist);
         LOG_ERR(" LOCO Addr exist");
         return true;
-      }
     }
     return false;
 }
 
 static bool AddLoco(loco_t *item)
 {
-    if (config_db.loco_db_len < LOCO_LIST_LEN-1) {
-        if (check_addr(item, -1)) return false;
-        memcpy(&config_db.loco_db[config_db.loco_db_len], item, sizeof(loco_t));
-        config_db.loco_db_len++;
-        loco_list[0].len = config_db.loco_db_len;
+    if (loco_lib_count() < loco_lib_capacity()) {
+        if (check_addr(item, LOCO_LIB_NONE)) return false;
+        if (!loco_lib_add(item)) {
+            main_show_error(&err_value_err);
+            LOG_ERR(" LOCO not written");
+            return false;
+        }
+        loco_select();
         LOG_INFO_PRINTF("  LOCO added name=%s, addr=%u, ss=%s", item->name, item->addr, ss_list[item->ss]);
         config_update(DB_LOCO_DB);
     } else {
@@ -720,47 +776,58 @@ static bool AddLoco(loco_t *item)
     return true;
 }
 
-static bool EditLoco(uint8_t id, loco_t *item)
+static bool EditLoco(uint16_t id, loco_t *item)
 {
     if (check_addr(item, id)) return false;
-    memcpy(&config_db.loco_db[id], item, sizeof(loco_t));
-    LOG_INFO_PRINTF("  LOCO updated name=%s, addr=%u, ss=%s", config_db.loco_db[id].name, config_db.loco_db[id].addr, ss_list[config_db.loco_db[id].ss]);
+    if (!loco_lib_set(id, item)) {
+        main_show_error(&err_value_err);
+        LOG_ERR(" LOCO not written");
+        return false;
+    }
+    loco_select();
+    LOG_INFO_PRINTF("  LOCO updated name=%s, addr=%u, ss=%s", item->name, item->addr, ss_list[item->ss]);
     config_update(DB_LOCO_DB);
     return true;
 }
 
-/* Called by menu_ll.c */
-bool DeleteLoco(uint8_t id)
+/* Called by menu_ll.c. The last entry takes the place of the deleted one. */
+bool DeleteLoco(uint16_t id)
 {
-    if (config_db.loco_db_len) {
-        for (uint8_t i=id+1; i<config_db.loco_db_len; i++) {
-            config_db.loco_db[i-1] = config_db.loco_db[i];
-        }
-        config_db.loco_db_len--;
-        loco_list[0].len = config_db.loco_db_len;
-        LOG_INFO_PRINTF("  Delete loco %u", id);
-        config_update(DB_LOCO_DB);
-    } else {
+    uint16_t last = loco_lib_count() - 1;
+    if (!loco_lib_count()) {
         main_show_error(&err_lib_empty);
         LOG_ERR(" LOCO DB is empty");
         return false;
     }
+    if (!loco_lib_delete(id)) {
+        main_show_error(&err_value_err);
+        LOG_ERR(" LOCO not deleted");
+        return false;
+    }
+    if (config_db.loco_db_pos == last) config_db.loco_db_pos = id;
+    if (config_db.loco_db_pos >= loco_lib_count()) config_db.loco_db_pos = 0;
+    loco_select();
+    LOG_INFO_PRINTF("  Delete loco %u", id);
+    config_update(DB_LOCO_DB);
     return true;
 }
 
 static bool callback_loco_name(void * param, uint32_t flags, bool read)
 {
-    uint8_t loco_id;
+    uint16_t loco_id;
+    loco_t loco;
     if (!param) return false;
 
     if (!read) {
-        strncpy(loco_current.name, param, STRING_LEN);
+        strncpy(loco_current.name, param, LOCO_NAME_LEN);
+        loco_current.name[LOCO_NAME_LEN] = '\0';
     } else if ((flags & FLAGS_ACTION_MASK) == FLAGS_EDIT_LOCO) {
-        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>8;
-        strncpy(param, config_db.loco_db[loco_id].name, STRING_LEN);
+        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>FLAGS_LOCO_ID_SHIFT;
+        if (!loco_lib_get(loco_id, &loco)) return false;
+        strncpy(param, loco.name, STRING_LEN);
     } else {
         /* New loco -> reset current_loco data */
-        strncpy(loco_current.name, seq_loco[SEQ_LOCO_NAME_POS].init_val, STRING_LEN);
+        strncpy(loco_current.name, seq_loco[SEQ_LOCO_NAME_POS].init_val, sizeof(loco_current.name));
         loco_current.addr = atoi(seq_loco[SEQ_LOCO_ADDR_POS].init_val);
         loco_current.ss = seq_loco[SEQ_LOCO_SS_POS].init_pos;
         return false;
@@ -770,14 +837,16 @@ static bool callback_loco_name(void * param, uint32_t flags, bool read)
 
 static bool callback_loco_addr(void * param, uint32_t flags, bool read)
 {
-    uint8_t loco_id;
+    uint16_t loco_id;
+    loco_t loco;
     if (!param) return false;
 
     if (!read) {
         loco_current.addr = atoi((char*)param);
     } else if ((flags & FLAGS_ACTION_MASK) == FLAGS_EDIT_LOCO) {
-        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>8;
-        U16ToStr(config_db.loco_db[loco_id].addr, param);
+        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>FLAGS_LOCO_ID_SHIFT;
+        if (!loco_lib_get(loco_id, &loco)) return false;
+        U16ToStr(loco.addr, param);
     } else {
         /* New loco */
         U16ToStr(loco_current.addr, param);
@@ -787,20 +856,22 @@ static bool callback_loco_addr(void * param, uint32_t flags, bool read)
 
 static bool callback_loco_ss(void * param, uint32_t flags, bool read)
 {
-    uint8_t loco_id;
+    uint16_t loco_id;
+    loco_t loco;
     if (!param) return false;
 
     if (!read) {
         loco_current.ss = *(uint8_t*)param;
         if ((flags & FLAGS_ACTION_MASK) == FLAGS_EDIT_LOCO) {
-            loco_id = (flags & FLAGS_LOCO_ID_MASK)>>8;
+            loco_id = (flags & FLAGS_LOCO_ID_MASK)>>FLAGS_LOCO_ID_SHIFT;
             return EditLoco(loco_id, &loco_current);
         } else {
             return AddLoco(&loco_current);
         }
     } else if ((flags & FLAGS_ACTION_MASK) == FLAGS_EDIT_LOCO) {
-        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>8;
-        ((uint8_t*)param)[0] = config_db.loco_db[loco_id].ss;
+        loco_id = (flags & FLAGS_LOCO_ID_MASK)>>FLAGS_LOCO_ID_SHIFT;
+        if (!loco_lib_get(loco_id, &loco)) return false;
+        ((uint8_t*)param)[0] = loco.ss;
     } else {
         /* New loco */
         ((uint8_t*)param)[0] = loco_current.ss;
@@ -996,33 +1067,34 @@ static bool callback_contrast(void * param, uint32_t flags, bool read)
 /* ///////////////////////////////////////////////////////////// */
 static void loco_show(void)
 {
-    if (config_db.loco_db_pos < config_db.loco_db_len) {
-        lcd_main_print(config_db.loco_db[config_db.loco_db_pos].name, 0, ALIGN_CENTER);
-        LOG_INFO_PRINTF("\rL:%s", config_db.loco_db[config_db.loco_db_pos].name);
+    if (config_db.loco_db_pos < loco_lib_count()) {
+        lcd_main_print(loco_sel.name, 0, ALIGN_CENTER);
+        z21Client_subscribeLoco(loco_sel.addr);
+        LOG_INFO_PRINTF("\rL:%s", loco_sel.name);
     } else {
         lcd_main_print(text_new_q[config_db.language_id], 0, ALIGN_CENTER);
     }
 }
 
-static void loco_change_dir(void)
+static void loco_change_dir(loco_state_t *st)
 {
-    if (config_db.loco_db[config_db.loco_db_pos].speed > 0) {
-        config_db.loco_db[config_db.loco_db_pos].dir_left = false;
+    if (st->speed > 0) {
+        st->dir_left = false;
         lcd_set_pause(false);
         lcd_set_left(false);
-        lcd_set_mode(true, config_db.loco_db[config_db.loco_db_pos].dir_left, false, true);
+        lcd_set_mode(true, st->dir_left, false, true);
         lcd_set_right(true);
-    } else if (config_db.loco_db[config_db.loco_db_pos].speed < 0) {
-        config_db.loco_db[config_db.loco_db_pos].dir_left = true;
+    } else if (st->speed < 0) {
+        st->dir_left = true;
         lcd_set_pause(false);
         lcd_set_right(false);
-        lcd_set_mode(true, config_db.loco_db[config_db.loco_db_pos].dir_left, false, true);
+        lcd_set_mode(true, st->dir_left, false, true);
         lcd_set_left(true);
     } else {
         lcd_set_right(false);
         lcd_set_left(false);
         lcd_set_pause(true);
-        lcd_set_mode(true, config_db.loco_db[config_db.loco_db_pos].dir_left, false, true);
+        lcd_set_mode(true, st->dir_left, false, true);
     }
 }
 
@@ -1030,8 +1102,8 @@ static void loco_show_func(void)
 {
     uint32_t func_mask, func;
 
-    if (config_db.loco_db_pos < config_db.loco_db_len) {
-        func = config_db.loco_db[config_db.loco_db_pos].func;
+    if (config_db.loco_db_pos < loco_lib_count()) {
+        func = loco_cur_state()->func;
     } else func = 0;
     lcd_set_loco_func(0, (func & (1<<0)) ? true : false);
     for (uint8_t key=loco_func_shift+1; key<=loco_func_shift+10; key++) {
@@ -1041,22 +1113,22 @@ static void loco_show_func(void)
     }
 }
 
-static void set_loco_throttle(bool force)
+static void set_loco_throttle(loco_state_t *st, bool force)
 {
   static int8_t last_dir = 0x10;
-  lcd_set_loco_throttle(abs(config_db.loco_db[config_db.loco_db_pos].speed), true);
+  lcd_set_loco_throttle(abs(st->speed), true);
   int8_t cur_dir = 0;
-  if (config_db.loco_db[config_db.loco_db_pos].speed > 0) cur_dir = 1;
-  else if (config_db.loco_db[config_db.loco_db_pos].speed < 0) cur_dir = -1;
+  if (st->speed > 0) cur_dir = 1;
+  else if (st->speed < 0) cur_dir = -1;
 
-  if ((cur_dir != last_dir) || force) loco_change_dir();
+  if ((cur_dir != last_dir) || force) loco_change_dir(st);
   last_dir = cur_dir;
 }
 
 void loco_begin(void)
 {
     lcd_begin();
-    set_loco_throttle(true);
+    set_loco_throttle(loco_cur_state(), true);
     lcd_bottom_print(NULL, ALIGN_NONE);
     loco_show_func();
     loco_show();
@@ -1082,29 +1154,29 @@ void loco_exit(void)
     lcd_commit();
 }
 
-static void SendSpeed(bool emergency_stop)
+static void SendSpeed(loco_state_t *st, bool emergency_stop)
 {
     static uint8_t dir = 0x80;
     uint8_t steps, speed;
     steps = 128;
-    if (config_db.loco_db[config_db.loco_db_pos].ss < sizeof(ss_val))
-        steps = ss_val[config_db.loco_db[config_db.loco_db_pos].ss];
+    if (loco_sel.ss < sizeof(ss_val))
+        steps = ss_val[loco_sel.ss];
     /* Calculate speed step according to steps configuration
      *  NOTE: 0 - normal stop
      *        1 - E-stop
      *        2 - step-1
      */
     speed = 0;
-    if (config_db.loco_db[config_db.loco_db_pos].speed) {
+    if (st->speed) {
         switch (steps) {
           case 128:
-            speed = (abs(config_db.loco_db[config_db.loco_db_pos].speed) * 126 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0x7F-126);
+            speed = (abs(st->speed) * 126 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0x7F-126);
             break;
           case 14:
-            speed = (abs(config_db.loco_db[config_db.loco_db_pos].speed) * 14 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0xF-14);
+            speed = (abs(st->speed) * 14 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0xF-14);
             break;
           case 28:
-            speed = (abs(config_db.loco_db[config_db.loco_db_pos].speed) * 28 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0x1F-28);
+            speed = (abs(st->speed) * 28 + LOCO_MAX_STEP/2) / LOCO_MAX_STEP + (0x1F-28);
             break;
           default:
             break;
@@ -1112,27 +1184,30 @@ static void SendSpeed(bool emergency_stop)
     } else if (emergency_stop) {
       speed = 1;
     }
-    if (config_db.loco_db[config_db.loco_db_pos].speed > 0) dir = 0x80;
-    else if (config_db.loco_db[config_db.loco_db_pos].speed < 0) dir = 0x00;
+    if (st->speed > 0) dir = 0x80;
+    else if (st->speed < 0) dir = 0x00;
     speed |= dir;
-    z21Client_setSpeed(config_db.loco_db[config_db.loco_db_pos].addr, steps, speed);
+    z21Client_setSpeed(loco_sel.addr, steps, speed);
 }
 
 void loco_next(void)
 {
     lcd_begin();
     if (loco_choose) {
-        config_db.loco_db_pos = INC(config_db.loco_db_pos, 0, config_db.loco_db_len);
+        config_db.loco_db_pos = INC(config_db.loco_db_pos, 0, loco_lib_count());
+        loco_select();
         loco_show();
-    } else if ((config_db.loco_db_pos < config_db.loco_db_len)
-        && (config_db.loco_db[config_db.loco_db_pos].speed < LOCO_MAX_STEP)) {
-        config_db.loco_db[config_db.loco_db_pos].speed++;
-        set_loco_throttle(false);
-        SendSpeed(false);
+    } else if (config_db.loco_db_pos < loco_lib_count()) {
+        loco_state_t *st = loco_cur_state();
+        if (st->speed < LOCO_MAX_STEP) {
+            st->speed++;
+            set_loco_throttle(st, false);
+            SendSpeed(st, false);
 #if LOG_PRINTF_ENABLED
-        loco_show();
-        LOG_INFO_PRINTF("  LOCO Step %+3i", config_db.loco_db[config_db.loco_db_pos].speed);
+            loco_show();
+            LOG_INFO_PRINTF("  LOCO Step %+3i", st->speed);
 #endif
+        }
     }
     lcd_commit();
 }
@@ -1141,17 +1216,20 @@ void loco_prev(void)
 {
     lcd_begin();
     if (loco_choose) {
-        config_db.loco_db_pos = DEC(config_db.loco_db_pos, 0, config_db.loco_db_len);
+        config_db.loco_db_pos = DEC(config_db.loco_db_pos, 0, loco_lib_count());
+        loco_select();
         loco_show();
-    } else if ((config_db.loco_db_pos < config_db.loco_db_len)
-        && (config_db.loco_db[config_db.loco_db_pos].speed > -LOCO_MAX_STEP)) {
-        config_db.loco_db[config_db.loco_db_pos].speed--;
-        set_loco_throttle(false);
-        SendSpeed(false);
+    } else if (config_db.loco_db_pos < loco_lib_count()) {
+        loco_state_t *st = loco_cur_state();
+        if (st->speed > -LOCO_MAX_STEP) {
+            st->speed--;
+            set_loco_throttle(st, false);
+            SendSpeed(st, false);
 #if LOG_PRINTF_ENABLED
-        loco_show();
-        LOG_INFO_PRINTF("  LOCO Step %+3i", config_db.loco_db[config_db.loco_db_pos].speed);
+            loco_show();
+            LOG_INFO_PRINTF("  LOCO Step %+3i", st->speed);
 #endif
+        }
     }
     lcd_commit();
 }
@@ -1159,7 +1237,7 @@ void loco_prev(void)
 void loco_shift(bool status)
 {
     static uint32_t last_button_time = 0;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
     uint32_t curr_time = millis();
 #else
     #include <time.h>
@@ -1184,23 +1262,25 @@ void loco_key(uint8_t key)
 {
     key += loco_func_shift;
     uint32_t func_mask = 1<<key;
+    loco_state_t *st;
     bool status;
 
-    if (config_db.loco_db_pos < config_db.loco_db_len) {
-        if ((config_db.loco_db[config_db.loco_db_pos].func & func_mask) != 0)
-            config_db.loco_db[config_db.loco_db_pos].func &=~ func_mask;
-        else config_db.loco_db[config_db.loco_db_pos].func |= func_mask;
+    if (config_db.loco_db_pos < loco_lib_count()) {
+        st = loco_cur_state();
+        if ((st->func & func_mask) != 0)
+            st->func &=~ func_mask;
+        else st->func |= func_mask;
 
-        status = (config_db.loco_db[config_db.loco_db_pos].func & func_mask) ? true : false;
+        status = (st->func & func_mask) ? true : false;
         lcd_set_loco_func(key, status);
-        z21Client_setLocoFunc(config_db.loco_db[config_db.loco_db_pos].addr, key, config_db.loco_db[config_db.loco_db_pos].func);
+        z21Client_setLocoFunc(loco_sel.addr, key, st->func);
         LOG_INFO_PRINTF("FUNC %u = %u", key, status);
     }
 }
 
 void loco_enter(void)
 {
-    if (config_db.loco_db_pos < config_db.loco_db_len) {
+    if (config_db.loco_db_pos < loco_lib_count()) {
         loco_key(0);
     } else {
         seq_start(PAGE_LOCO, FLAGS_NEW_LOCO, seq_loco);
@@ -1215,13 +1295,34 @@ void turnout_show(void)
     LOG_INFO_PRINTF("\rT:%s", str);
 }
 
+/* Show the position reported by the command station if known, otherwise the
+ * last one set from here */
+static void turnout_show_state(void)
+{
+    bool state;
+    if (z21Client_getTrntPos(config_db.turnout_id-1, &state)) config_db.turnout_state = state;
+    lcd_set_mode(false, config_db.turnout_state, false, true);
+}
+
+/* Ask for the unknown positions of the shown turnout and the next ones in one
+ * datagram, so stepping through the IDs finds them cached */
+static void turnout_query(void)
+{
+    z21Client_beginBatch();
+    for (uint16_t id=config_db.turnout_id; (id < config_db.turnout_id + TURNOUT_PREFETCH) && (id <= MAX_TURNOUT_ID); id++) {
+        if (!z21Client_getTrntPos(id-1, NULL)) z21Client_requestTrntInfo(id-1);
+    }
+    z21Client_flushBatch();
+}
+
 void turnout_begin(void)
 {
     lcd_begin();
     loco_exit_local();
-    lcd_set_mode(false, config_db.turnout_state, false, true);
+    turnout_show_state();
     turnout_show();
     lcd_commit();
+    turnout_query();
 }
 
 void turnout_exit(void)
@@ -1238,8 +1339,10 @@ void turnout_set_id(uint16_t id)
 
     lcd_begin();
     config_db.turnout_id = id;
+    turnout_show_state();
     turnout_show();
     lcd_commit();
+    turnout_query();
     config_update(DB_CONFIG);
 }
 
@@ -1282,16 +1385,17 @@ void turnout_key(uint8_t key)
 void track_stop(void)
 {
     if (current_page == PAGE_LOCO) {
+        loco_state_t *st = loco_cur_state();
         if (loco_func_shift) {
-          config_db.loco_db[config_db.loco_db_pos].speed = 0;
-          set_loco_throttle(false);
-          SendSpeed(true);
+          st->speed = 0;
+          set_loco_throttle(st, false);
+          SendSpeed(st, true);
           return;
         }
-        if (config_db.loco_db[config_db.loco_db_pos].speed) {
-          config_db.loco_db[config_db.loco_db_pos].speed = 0;
-          set_loco_throttle(false);
-          SendSpeed(false);
+        if (st->speed) {
+          st->speed = 0;
+          set_loco_throttle(st, false);
+          SendSpeed(st, false);
           return;
         }
     }
@@ -1356,12 +1460,12 @@ static void notifyXNetPower(uint8_t status)
     lcd_commit();
 }
 
-static void notifyXNetExtControl(uint16_t locoAddress)
+static void notifyXNetExtControl(uint16_t locoAddress, bool busy)
 {
-  LOG_INFO("notifyXNetExtControl\n\r");
-  if ((current_page == PAGE_LOCO) && (config_db.loco_db[config_db.loco_db_pos].addr == locoAddress)) {
+  if ((current_page == PAGE_LOCO) && (loco_sel.addr == locoAddress)) {
+      if (busy) LOG_INFO("notifyXNetExtControl\n\r");
       lcd_begin();
-      lcd_set_mode(true, config_db.loco_db[config_db.loco_db_pos].dir_left, true, true);
+      lcd_set_mode(true, loco_cur_state()->dir_left, busy, true);
       lcd_commit();
   }
 }
@@ -1369,13 +1473,14 @@ static void notifyXNetExtControl(uint16_t locoAddress)
 static void notifyXNetExtSpeed(uint16_t locoAddress, uint8_t steps, uint8_t value)
 {
     //LOG_INFO("notifyXNetExtSpeed\n\r");
-    if (config_db.loco_db[config_db.loco_db_pos].addr == locoAddress){
-        config_db.loco_db[config_db.loco_db_pos].speed = ((value & 0x80) ? 1 : -1) * ((int16_t)LOCO_MAX_STEP * (value & 0x7F) + (steps-1)/2) / (steps-1);
-        if (current_page == PAGE_LOCO) {
-          lcd_begin();
-          set_loco_throttle(false);
-          lcd_commit();
-        }
+    if (loco_lib_find(locoAddress) == LOCO_LIB_NONE) return;
+
+    loco_state_t *st = loco_state_get(locoAddress);
+    st->speed = ((value & 0x80) ? 1 : -1) * ((int16_t)LOCO_MAX_STEP * (value & 0x7F) + (steps-1)/2) / (steps-1);
+    if ((locoAddress == loco_sel.addr) && (current_page == PAGE_LOCO)) {
+        lcd_begin();
+        set_loco_throttle(st, false);
+        lcd_commit();
     }
 }
 
@@ -1383,27 +1488,37 @@ static void notifyXNetExtFunc(uint16_t locoAddress, uint32_t funcMask, uint32_t
 {
     //LOG_INFO("notifyXNetExtFunc\n\r");
     uint32_t newFunctionStates, functionChanged, mask;
-    if (config_db.loco_db[config_db.loco_db_pos].addr == locoAddress){
-        newFunctionStates = config_db.loco_db[config_db.loco_db_pos].func & (~funcMask);
-        newFunctionStates |= funcStatus;
-        functionChanged = newFunctionStates ^ config_db.loco_db[config_db.loco_db_pos].func;
-        config_db.loco_db[config_db.loco_db_pos].func = newFunctionStates;
-        if (current_page == PAGE_LOCO) {
-          lcd_begin();
-          //Check Light function
-          mask = 1<<0;
-          if ((functionChanged & mask) != 0) {
-              lcd_set_loco_func(0, (config_db.loco_db[config_db.loco_db_pos].func & mask) ? true : false);
-          }
-          //Check the rest based on current shift state
-          for (uint8_t id=loco_func_shift+1; id<loco_func_shift+10; id++) {
-            mask = 1<<id;
-            if ((functionChanged & mask) != 0) {
-              lcd_set_loco_func(id, (config_db.loco_db[config_db.loco_db_pos].func & mask) ? true : false);
-            }
-          }
-          lcd_commit();
+    if (loco_lib_find(locoAddress) == LOCO_LIB_NONE) return;
+
+    loco_state_t *loco = loco_state_get(locoAddress);
+    newFunctionStates = loco->func & (~funcMask);
+    newFunctionStates |= funcStatus;
+    functionChanged = newFunctionStates ^ loco->func;
+    loco->func = newFunctionStates;
+    if ((locoAddress == loco_sel.addr) && (current_page == PAGE_LOCO)) {
+      lcd_begin();
+      //Check Light function
+      mask = 1<<0;
+      if ((functionChanged & mask) != 0) {
+          lcd_set_loco_func(0, (loco->func & mask) ? true : false);
+      }
+      //Check the rest based on current shift state
+      for (uint8_t id=loco_func_shift+1; id<loco_func_shift+10; id++) {
+        mask = 1<<id;
+        if ((functionChanged & mask) != 0) {
+          lcd_set_loco_func(id, (loco->func & mask) ? true : false);
         }
+      }
+      lcd_commit();
+    }
+}
+
+static void notifyXNetFeedback(uint16_t address, uint8_t stateMask, uint8_t state)
+{
+    if ((current_page == PAGE_TURNOUT) && (address == config_db.turnout_id-1)) {
+        lcd_begin();
+        turnout_show_state();
+        lcd_commit();
     }
 }
 
@@ -1436,7 +1551,7 @@ static const z21client_callback_t z21client_callback = {
     .notifyXNetExtFunc = notifyXNetExtFunc,
     .notifyXNetService = notifyXNetService,
     .notifyXNetServiceError = notifyXNetServiceError,
-    .notifyXNetFeedback = NULL
+    .notifyXNetFeedback = notifyXNetFeedback
 };
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -1455,13 +1570,12 @@ void main_reset_data(config_flags_t flags)
     }
     if (flags & DB_LOCO_DB) {
       LOG_INFO("Reset loco_db\n\r");
-      memset(config_db.loco_db, 0, sizeof(config_db.loco_db));
+      loco_t loco = {"DEFLT", 2, 3};
+      loco_lib_clear();
+      loco_lib_add(&loco);
+      memset(loco_state, 0, sizeof(loco_state));
       config_db.loco_db_pos = 0;
-      config_db.loco_db_len = 1;
-      loco_list[0].len = config_db.loco_db_len;
-      strcpy(config_db.loco_db[0].name, "DEFLT");
-      config_db.loco_db[0].addr = 3;
-      config_db.loco_db[0].ss = 2;
+      loco_select();
     }
     if (flags & DB_WIFI) {
       LOG_INFO("Reset wifi data\n\r");
@@ -1475,20 +1589,16 @@ void main_reset_data(config_flags_t flags)
 
 void main_page_init(void)
 {
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
     prog_timeout_timer = callback_timer_create();
 #endif
 
     prog_cv.cv = 0;
     menu_set_language(config_db.language_id);
     menu_set_childlock(config_db.child_level, config_db.child_password, &item_password);
-    loco_list[0].len = config_db.loco_db_len;
-    for (uint8_t i=0; i < LOCO_LIST_LEN; i++) {
-        loco_list[i].subseq = seq_loco;
-        text_loconame[i] = (const char *)&config_db.loco_db[i].name;
-        loco_list[i].name = (text_list_t *)&text_loconame[i];
-        loco_list[i].skip_on_return = true;
-    }
+    loco_list[0].subseq = seq_loco;
+    loco_list[0].skip_on_return = true;
+    loco_select();
     z21Client_setEventCallbacks(z21client_callback);
 }
 
@@ -1555,8 +1665,9 @@ static uint8_t U16ToStr(uint16_t val, char *str)
 }
 
 #define ADD_TO_BUF(_buf, _len, _x, ...) do {            \
-    uint8_t res = snprintf(_buf, _len, _x, __VA_ARGS__);\
-    buf += res; len -= res; if (len <= 0) return false; \
+    int res = snprintf(_buf, _len, _x, __VA_ARGS__);    \
+    if ((res < 0) || (res >= _len)) return -1;          \
+    _buf += res; _len -= res;                           \
 }while(0)
 
 int print_config_db(char * buf, uint16_t len)
@@ -1571,9 +1682,24 @@ int print_config_db(char * buf, uint16_t len)
             db->maskaddr[0], db->maskaddr[1], db->maskaddr[2], db->maskaddr[3] );
     ADD_TO_BUF(buf, len, "%u;%u;%u;%u;\n", db->ip_z21[0], db->ip_z21[1], db->ip_z21[2], db->ip_z21[3]);
     ADD_TO_BUF(buf, len, "%u;%u;%u;%u;%u;%u;\n", db->stop_mode, db->language_id, db->child_level, db->child_password, db->idle_time_min, db->contrast);
-    ADD_TO_BUF(buf, len, "%u;%u;\n", db->turnout_id, db->loco_db_len);
-    for (uint8_t i=0; i<db->loco_db_len; i++) {
-        ADD_TO_BUF(buf, len, "%s;%u;%u;\n", db->loco_db[i].name, db->loco_db[i].addr, db->loco_db[i].ss);
+    ADD_TO_BUF(buf, len, "%u;%u;\n", db->turnout_id, loco_lib_count());
+    return buf - b_ptr;
+}
+
+/* The library follows print_config_db() in parts, as many lines from *id on
+ * as fit into buf. Returns the length, 0 once all locos are printed. */
+int print_config_loco(char * buf, uint16_t len, uint16_t * id)
+{
+    char *b_ptr = buf;
+    loco_t loco;
+
+    for (; *id < loco_lib_count(); (*id)++) {
+        int res;
+        if (!loco_lib_get(*id, &loco)) break;
+        res = snprintf(buf, len, "%s;%u;%u;\n", loco.name, loco.addr, loco.ss);
+        if ((res < 0) || (res >= len)) break;
+        buf += res;
+        len -= res;
     }
     *buf = '\0';
     return buf - b_ptr;
@@ -1604,7 +1730,8 @@ bool parse_config_db(char * buf, uint16_t len)
     config_db_t *db = &config_db;
     char * strt = buf;
     char * end;
-    uint8_t pos = 0;
+    uint16_t pos = 0;
+    loco_t loco;
 
     do {
         if ((strt) && (*(strt) == '\n')) strt++;
@@ -1628,15 +1755,19 @@ bool parse_config_db(char * buf, uint16_t len)
             PARSE_INT(23, db->idle_time_min, strt)
             PARSE_INT(24, db->contrast, strt)
             PARSE_INT(25, db->turnout_id, strt)
-            PARSE_INT(26, db->loco_db_len, strt)
             }
         } else {
-            uint8_t loco_id = (pos - 27)/3;
+            uint16_t loco_id = (pos - 27)/3;
             uint8_t loco_item = (pos - 27) % 3;
             switch (loco_item) {
-                PARSE_STR(0, db->loco_db[loco_id].name, sizeof(db->loco_db[loco_id].name), strt)
-                PARSE_INT(1, db->loco_db[loco_id].addr, strt)
-                PARSE_INT(2, db->loco_db[loco_id].ss, strt)
+                PARSE_STR(0, loco.name, LOCO_NAME_LEN, strt)
+                PARSE_INT(1, loco.addr, strt)
+                case 2:
+                    loco.ss = atoi(strt);
+                    loco.name[LOCO_NAME_LEN] = '\0';
+                    if (loco_id < loco_lib_count()) loco_lib_set(loco_id, &loco);
+                    else loco_lib_add(&loco);
+                    break;
             }
         }
         strt = end+1;
@@ -1644,6 +1775,7 @@ bool parse_config_db(char * buf, uint16_t len)
     }
     while (1);
 
-    loco_list[0].len = config_db.loco_db_len;
+    memset(loco_state, 0, sizeof(loco_state));
+    loco_select();
     return true;
 }
@@ -23,14 +23,23 @@
 extern "C" {
 #endif
 
+#define LOCO_NAME_LEN   6
+
+/* Library record, kept by loco_lib.c */
 typedef struct {
-    char name[STRING_LEN];
-    uint16_t addr;
+    char name[LOCO_NAME_LEN+1];
     uint8_t ss;
+    uint16_t addr;
+} loco_t;
+
+/* Runtime state of a library loco, kept in RAM only */
+typedef struct {
+    uint16_t addr;
+    uint16_t used;
     uint32_t func;
     int8_t speed;
     bool dir_left;
-} loco_t;
+} loco_state_t;
 
 typedef struct {
     uint16_t addr;
@@ -38,27 +47,29 @@ typedef struct {
     uint16_t val;
 } prog_cv_t;
 
+/* Grouped by the sections of config_schema.c, the layout in the EEPROM page
+ * does not follow the one of this structure */
 typedef struct {
+    //CONFIG_TAG_WIFI
     char ssid[32];
     char pass[32];
-    uint8_t stop_mode;
-    uint8_t language_id;
-    uint8_t child_level;
-    uint16_t child_password;
     uint8_t ipaddr[4];
     uint8_t gwaddr[4];
     uint8_t maskaddr[4];
-    bool dhcp;
     uint8_t ip_z21[4];
-    uint16_t turnout_id;
-    bool turnout_state;
-    uint8_t loco_db_len;
-    uint8_t loco_db_pos;
-    loco_t loco_db[LOCO_LIST_LEN];
+    bool dhcp;
+    //CONFIG_TAG_CONFIG
+    uint8_t stop_mode;
+    uint8_t language_id;
+    uint8_t child_level;
+    uint16_t child_password;
     uint8_t idle_time_min;
     bool webpage_en;
     uint8_t contrast;
-    uint16_t magic;
+    bool turnout_state;
+    uint16_t turnout_id;
+    //CONFIG_TAG_LOCO, the library itself is kept by loco_lib.c
+    uint16_t loco_db_pos;
 }config_db_t;
 extern config_db_t config_db;
 
@@ -80,6 +91,7 @@ extern const erritem_t err_lib_full;
 extern const erritem_t err_exist;
 extern const erritem_t err_value_err;
 extern const erritem_t err_conn_fault;
+extern const erritem_t err_no_fs;
 
 extern const mitem_t menu_base[];
 void main_page_init(void);
@@ -89,6 +101,7 @@ void main_set_config_update_callback(config_update_callback_t callback);
 void main_reset_data(config_flags_t flags);
 
 int print_config_db(char * buf, uint16_t len);
+int print_config_loco(char * buf, uint16_t len, uint16_t * id);
 bool parse_config_db(char * buf, uint16_t len);
 void turnout_begin(void);
 void turnout_exit(void);
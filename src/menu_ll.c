@@ -31,7 +31,8 @@ typedef struct {
     uint8_t level;
     const mitem_t *parent[MAX_MENU_LEVEL];
     uint8_t parent_pos[MAX_MENU_LEVEL];
-    uint16_t parent_flags;
+    uint32_t parent_flags;
+    uint16_t loco_pos;      //library entry shown while menu.current is loco_list
     uint8_t child_level;
     uint16_t child_password;
     const seqitem_t *child_edit_item;
@@ -100,7 +101,9 @@ static sequence_t sequence;
 
 extern mitem_t loco_list[];
 /* Extern functions */
-extern bool DeleteLoco(uint8_t id);
+extern bool DeleteLoco(uint16_t id);
+extern uint16_t LocoCount(void);
+extern const char * LocoName(uint16_t id);
 
 static void incStr(char *str, uint8_t max_len);
 static void decStr(char *str, uint8_t max_len);
@@ -112,8 +115,10 @@ static inline void menu_show_main(void)
 
     //main print
     item = &menu.current[menu.pos];
-    if (item->name) {
-        str = item->name[(menu.current == loco_list) ? 0 : lang_id];
+    if (menu.current == loco_list) {
+        lcd_main_print(LocoName(menu.loco_pos), 0, ALIGN_CENTER);
+    } else if (item->name) {
+        str = item->name[lang_id];
         lcd_main_print(str, 0, ALIGN_CENTER);
     }else LOG_ERR("Name list for main is not provided");
 }
@@ -145,6 +150,11 @@ static void menu_show(void)
 void menu_next(void)
 {
     uint8_t max_len = menu.current[0].len;
+    if (menu.current == loco_list) {
+        menu.loco_pos = (menu.loco_pos < (LocoCount()-1)) ? (menu.loco_pos+1) : (0);
+        menu_show();
+        return;
+    }
     menu.pos = (menu.pos < (max_len-1)) ? (menu.pos+1) : (0);
     menu_show();
 }
@@ -152,6 +162,11 @@ void menu_next(void)
 void menu_prev(void)
 {
     uint8_t max_len = menu.current[0].len;
+    if (menu.current == loco_list) {
+        menu.loco_pos = (menu.loco_pos > 0) ? (menu.loco_pos-1) : (LocoCount()-1);
+        menu_show();
+        return;
+    }
     menu.pos = (menu.pos > 0) ? (menu.pos-1) : (max_len-1);
     menu_show();
 }
@@ -161,13 +176,13 @@ static void menu_enter_local(void)
     const mitem_t * item = &menu.current[menu.pos];
     if (menu.current == loco_list) {
         if ((menu.parent_flags & FLAGS_ACTION_MASK) == FLAGS_DELETE_LOCO) {
-            if (!DeleteLoco(menu.pos)) return;
+            if (!DeleteLoco(menu.loco_pos)) return;
             page_return_back(PAGE_MENU, NULL);
             return;
         }
         if ((menu.parent_flags & FLAGS_ACTION_MASK) == FLAGS_EDIT_LOCO) {
             menu.parent_flags &=~ FLAGS_LOCO_ID_MASK;
-            menu.parent_flags |= menu.pos<<8;
+            menu.parent_flags |= (uint32_t)menu.loco_pos<<FLAGS_LOCO_ID_SHIFT;
         }
     }
     if ((item->submenu && item->submenu->len)
@@ -179,6 +194,7 @@ static void menu_enter_local(void)
         if (item->submenu) {
             menu.current = item->submenu;
             menu.pos = 0;
+            menu.loco_pos = 0;
             menu_show();
         } else {
             //TODO: menu_show_bottom();
@@ -32,13 +32,13 @@ extern "C" {
 #define FLAGS_LOCK_OFF      0x0005
 #define FLAGS_LOCK_SET      0x0006
 #define FLAGS_LOCK_LIB      0x0007
-#define FLAGS_LOCO_ID_MASK  0xFF00
+#define FLAGS_LOCO_ID_MASK  0xFFFF0000
+#define FLAGS_LOCO_ID_SHIFT 16
 
 /* PAGE definition and actions  */
 #define MAX_MENU_LEVEL  4
 #define STRING_LEN      32
 #define SHOW_LEN        6
-#define LOCO_LIST_LEN   64
 #define MAX_CHILD_LEVEL 2
 
 typedef enum {
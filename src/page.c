@@ -27,7 +27,7 @@ typedef enum {
   ACTION_PREV = 2
 } action_t;
 static action_t current_action;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
 static uint32_t action_start_time;
 #endif
 
@@ -94,7 +94,7 @@ void page_event_next(bool state)
     case PAGE_LOCO:
         loco_next();
         current_action = ACTION_NEXT;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
         action_start_time = millis();
 #endif
         break;
@@ -121,7 +121,7 @@ void page_event_prev(bool state)
     case PAGE_LOCO:
         loco_prev();
         current_action = ACTION_PREV;
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
         action_start_time = millis();
 #endif
         break;
@@ -135,7 +135,7 @@ void page_event_prev(bool state)
 
 void page_repeat(void * arg)
 {
-#ifdef ESP8266
+#if defined(ESP8266) || defined(HOST_BUILD)
   if (millis() < action_start_time + 500)
     return;
 #endif
@@ -32,6 +32,9 @@
 #include "config.h"
 #include "log.h"
 #include "eeprom_hl.h"
+#include "config_store.h"
+#include "config_schema.h"
+#include "loco_lib.h"
 #include "ssd1306.h"
 #include "lcd_hl.h"
 #include "main_page.h"
@@ -59,6 +62,7 @@ static WiFiUDP Z21UDPClient;
 #endif
 ESP8266WebServer updateServer(80);
 static bool server_enabled = false;
+static bool config_kept = false;  //old config page with locos not in the library
 static void fw_notification_handler(fw_update_status_t status);
 ESP8266HTTPUpdateServer httpUpdater(false, fw_notification_handler);
 
@@ -66,6 +70,7 @@ extern "C" void WiFi_ResetToDefaults(void);
 
 static byte connectionTries = 0;
 static callback_handler_t wifi_timer, key_timeout_timer, powerdown_timer, status_timer, bat_timer, idle_timer, page_repeat_timer;
+static callback_handler_t store_timer;
 
 /**********************************************************************************/
 void DebugPrint(char *data) {
@@ -77,14 +82,33 @@ static void key_timeout_handler(void *arg)
   page_event_timeout();
 }
 
-static void powerdown_handler(void *arg)
+static void store_handler(void *arg)
+{
+  LOG_INFO("config store compaction\n\r");
+  config_store_compact();
+}
+
+/* Only the changed parts are appended, the page is compacted when idle */
+static void config_save(void)
 {
+  if (config_kept) {
+    LOG_ERR("config_db not saved, select a flash layout with FS, e.g. 4MB (FS:1MB)\n\r");
+    return;
+  }
   LOG_INFO("config_db saving to memory\n\r");
-  EEPROMwrite(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
-  EEPROM.commit();
+  config_store_save();
+  if (config_store_compact_pending())
+    callback_timer_start(store_timer, STORE_COMPACT_DELAY, false, store_handler, 0);
+}
+
+static void powerdown_handler(void *arg)
+{
+  config_save();
   digitalWrite(BUILTIN_LED_PIN, HIGH);
   pinMode(BUILTIN_LED_PIN, OUTPUT);
   ssd1306_PowerDown();
+  z21Client_logoff();
+  delay(10); //let the frame out before the radio is off
   ESP.deepSleep(0);
 }
 
@@ -125,10 +149,10 @@ static void buttons_event(uint8_t id, bool state)
   }
 }
 
-static inline void receiveEvent(uint8_t *data, uint8_t len) {
+static inline void receiveEvent(const uint8_t *data, uint16_t len) {
 #ifdef DATA_DEBUG
   LOG_INFO("UDP receive: ");
-  for (uint8_t i=0; i<len; i++) {
+  for (uint16_t i=0; i<len; i++) {
     if (data[i] < 16) LOG_INFO("0");
     LOG_INFO(data[i], HEX);
   }
@@ -149,11 +173,11 @@ static void onPacket(AsyncUDPPacket &packet)
 }
 #endif
 
-static void SendDataToZ21(byte *data, byte len)
+static void SendDataToZ21(uint8_t *data, uint16_t len)
 {
 #ifdef DATA_DEBUG
   LOG_INFO("UDP send: ");
-  for (uint8_t i=0; i<len; i++) {
+  for (uint16_t i=0; i<len; i++) {
     if (data[i] < 16) LOG_INFO("0");
     LOG_INFO(data[i], HEX);
   }
@@ -199,9 +223,7 @@ static void bat_handler(void * arg)
 
 static void config_update_callback(config_flags_t flags)
 {
-  LOG_INFO("config_db saving to memory\n\r");
-  EEPROMwrite(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
-  EEPROM.commit();
+  config_save();
   if (flags & DB_WIFI) {
     WiFi_ClientConfigUpdated();
   }
@@ -215,9 +237,7 @@ static void config_update_callback(config_flags_t flags)
 
 static void status_handler(void * arg) 
 {
-  if (WiFi.status() == WL_CONNECTED) {
-    z21Client_requestStatus();
-  }
+  z21Client_sessionTick(WiFi.status() == WL_CONNECTED);
 }
 
 static void fw_notification_handler(fw_update_status_t status)
@@ -241,6 +261,7 @@ static void fw_notification_handler(fw_update_status_t status)
   } else if (status == FW_UPDATE_RESTART) {
     WiFi.forceSleepBegin();
     lcd_bottom_print("Flashing...", ALIGN_CENTER);
+    lcd_flush();
     delay(10);
     ESP.restart();
   }
@@ -253,37 +274,47 @@ static void powerup_handler(void * arg)
   bat_handler(NULL);
   if (WiFi.status() != WL_CONNECTED) lcd_set_signal(0, true);
   page_start(PAGE_LOCO);
+  if (config_kept) main_show_error(&err_no_fs);
   buttons_init(buttons_event);
 }
 
 void setup() {
   bool memory_fault = false;
-  static_assert(sizeof(config_db) <= EE_SIZE, "config DB size is bigger the EEPROM page");
+  config_flags_t missing;
+  static_assert(CONFIG_SCHEMA_SIZE <= EE_SIZE, "config DB size is bigger the EEPROM page");
   
   key_timeout_timer = callback_timer_create();
   powerdown_timer = callback_timer_create();
   idle_timer = callback_timer_create();
+  store_timer = callback_timer_create();
   bat_timer = callback_timer_create();
   page_repeat_timer = callback_timer_create();
   
   EEPROM.begin(EE_SIZE);  //init EEPROM
   main_set_config_update_callback(config_update_callback);
-  EEPROMread(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
 #ifdef DEBUG_PRINT
   Serial.begin(115200, SERIAL_8N1);
   String msg = "sizeof(config_db)=";
   msg += sizeof(config_db);
   Serial.println(msg);
 #endif
-  if (config_db.magic != MAGIC_VALUE) {
-    config_db.magic = MAGIC_VALUE;
-    main_reset_data(0xFF);
-    EEPROM.commit();
-    memset(&config_db, 0, sizeof(config_db));
-    EEPROMread(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
-    if (config_db.magic != MAGIC_VALUE) 
+  loco_lib_init();  //before config_db, older stores move their locos into it
+  //Blank page or a store without some sections, e.g. added by this firmware
+  missing = config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage);
+  if (missing & CONFIG_SCHEMA_KEEP) {
+    //No room for the locos of the old page, e.g. no FS area in the flash layout:
+    //the library shows them read-only and the page is not written
+    config_kept = true;
+    missing &= ~CONFIG_SCHEMA_KEEP;
+  }
+  if (missing) {
+    main_reset_data(missing);  //saved by config_update_callback
+    if (!config_kept && config_schema_load(EEPROMimage(), EE_SIZE, EEPROMprogram, EEPROMcommitPage))
       memory_fault = true;
   }
+  //Sections converted from another version are written again when idle
+  if (!memory_fault && !config_kept && config_store_compact_pending())
+    callback_timer_start(store_timer, STORE_COMPACT_DELAY, false, store_handler, 0);
   FlashMode_t ideMode = ESP.getFlashChipMode();
   if ((ideMode != FM_DIO) && (ideMode != FM_DOUT)) {
     memory_fault = true;
@@ -297,6 +328,7 @@ void setup() {
     callback_timer_start(bat_timer, 10000, true, bat_handler, 0);
   } else {
     lcd_show_logo("MEMORY FAULT");
+    lcd_flush();
     while(1);
   }
 
@@ -315,7 +347,7 @@ void setup() {
 #endif
   z21Client_setSendDataCallback(SendDataToZ21);
   status_timer = callback_timer_create();
-  callback_timer_start(status_timer, 2000, true, status_handler, 0); 
+  callback_timer_start(status_timer, Z21_STATUS_PERIOD, true, status_handler, 0); 
   callback_timer_start(page_repeat_timer, 150, true, page_repeat, 0);
   LOG_INFO("Initialization done\n\r");
 }
@@ -381,13 +413,13 @@ static void parseChar(char c)
 void loop() {
 #ifndef ASYNC_UDP
   /* Z21 UDP receive data parsing */
-  byte packetSize = Z21UDPClient.parsePacket();
-  if (packetSize) {
+  int packetSize = Z21UDPClient.parsePacket();
+  if (packetSize > 0) {
     /* Send and save client Identity */
     IPAddress remoteIp = Z21UDPClient.remoteIP();
     if (remoteIp == config_db.ip_z21) {
-      uint8_t packetBuffer[packetSize];
-      byte len = Z21UDPClient.read(packetBuffer, packetSize);
+      static uint8_t packetBuffer[Z21_RX_MAX_SIZE];
+      int len = Z21UDPClient.read(packetBuffer, sizeof(packetBuffer));
       if (len > 0) receiveEvent(packetBuffer, len);
     }
   }
@@ -396,6 +428,8 @@ void loop() {
   while (Serial.available()) parseChar(Serial.read());
 #endif
   if (config_db.webpage_en) updateServer.handleClient();
+  z21Client_process(millis());
+  ssd1306_Process();
   delay(1);
 }
 
@@ -411,14 +445,18 @@ static const char webpage_end[] PROGMEM =
   "</body></html>";
 ESP8266WebServer *web_server;
  
+/* The library may hold more locos than fit into RAM as text, the page is
+ * sent in chunks of buf */
 static void main_webpage_get(void)
 {
-  char buf[1024];
-  int len = print_config_db(buf, sizeof(buf));
-  web_server->setContentLength(sizeof(webpage_begin)-1 + sizeof(webpage_end)-1 + len);
+  char buf[256];
+  uint16_t id = 0;
+  web_server->setContentLength(CONTENT_LENGTH_UNKNOWN);
   web_server->send_P(200,"text/html", webpage_begin);
-  web_server->sendContent(buf);
+  if (print_config_db(buf, sizeof(buf)) > 0) web_server->sendContent(buf);
+  while (print_config_loco(buf, sizeof(buf), &id) > 0) web_server->sendContent(buf);
   web_server->sendContent_P(webpage_end);
+  web_server->sendContent("");
 }
 
 static void main_webpage_post(void)
@@ -436,8 +474,7 @@ static void main_webpage_post(void)
     uint16_t len = web_server->arg(arg_id).length();
     if (parse_config_db(buf, len)) {
       Serial.println("Parsed successfully. Saving to memory");
-      EEPROMwrite(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
-      EEPROM.commit();
+      config_save();
     } else {
       Serial.println("Parsing error");
     }
@@ -472,9 +509,7 @@ void WiFi_ResetToDefaults(void) {
   memcpy(config_db.gwaddr, defaultGwCL, 4);
   memcpy(config_db.maskaddr, defaultMaskCL, 4);
   memcpy(config_db.ip_z21, defaultIpZ21, 4);
-  LOG_INFO("config_db saving to memory");
-  EEPROMwrite(EE_CONFIG_DB, (uint8_t*)&config_db, sizeof(config_db));
-  EEPROM.commit();
+  config_save();
 }
 
 static void wifi_handler(void * arg) {
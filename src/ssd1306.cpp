@@ -20,7 +20,30 @@
 #include <Wire.h>
 #include <ESP8266WiFi.h>
 
-static uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+#include <string.h>
+
+// Back buffer is drawn into, front buffer holds what the display RAM contains
+static uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_PAGES] __attribute__((aligned(4)));
+static uint8_t SSD1306_Front[SSD1306_WIDTH * SSD1306_PAGES] __attribute__((aligned(4)));
+static bool SSD1306_FrontValid;
+// Column range touched since the last update, per page. Clean page has min > max
+static uint8_t SSD1306_DirtyMin[SSD1306_PAGES];
+static uint8_t SSD1306_DirtyMax[SSD1306_PAGES];
+// Column range queued for transfer, per page, and the transfer position
+static uint8_t SSD1306_TxMin[SSD1306_PAGES];
+static uint8_t SSD1306_TxMax[SSD1306_PAGES];
+static uint8_t SSD1306_TxPage;
+static bool SSD1306_TxAddressed, SSD1306_TxBusy;
+static uint32_t SSD1306_TxStart;
+static uint16_t SSD1306_TxSaved;
+static ssd1306_stats_t SSD1306_Stats;
+static uint32_t SSD1306_BusBytes;
+
+static inline void ssd1306_MarkDirty(uint8_t page, uint8_t x_min, uint8_t x_max)
+{
+    if (x_min < SSD1306_DirtyMin[page]) SSD1306_DirtyMin[page] = x_min;
+    if (x_max > SSD1306_DirtyMax[page]) SSD1306_DirtyMax[page] = x_max;
+}
 
 void ssd1306_WriteCommand(uint8_t command)
 {
@@ -28,6 +51,7 @@ void ssd1306_WriteCommand(uint8_t command)
     Wire.write(0x00);
     Wire.write(command);
     Wire.endTransmission();
+    SSD1306_BusBytes += 3;
 }
 
 void ssd1306_WriteData(uint8_t* data, size_t len)
@@ -41,21 +65,145 @@ void ssd1306_WriteData(uint8_t* data, size_t len)
         Wire.write(data[i]);
       }
       Wire.endTransmission();
+      SSD1306_BusBytes += 2 + burst_len;
       len -= burst_len;
       data += burst_len;
     }
 }
 
-// Write the screenbuffer with changed to the screen
+// Queue the changed parts of the screenbuffer for transfer, see ssd1306_Process
 void ssd1306_UpdateScreen(void) 
 {
-    uint8_t i;
-    for(i = 0; i < 8; i++) {
-        ssd1306_WriteCommand(0xB0 + i);
-        ssd1306_WriteCommand(SSD1306_XSHIFT&0xF);
-        ssd1306_WriteCommand(0x10);
-        ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH*i],SSD1306_WIDTH);
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        if (SSD1306_DirtyMin[i] > SSD1306_DirtyMax[i]) continue;
+        if (SSD1306_DirtyMin[i] < SSD1306_TxMin[i]) {
+            SSD1306_TxMin[i] = SSD1306_DirtyMin[i];
+            if (i == SSD1306_TxPage) SSD1306_TxAddressed = false;
+        }
+        if (SSD1306_DirtyMax[i] > SSD1306_TxMax[i]) SSD1306_TxMax[i] = SSD1306_DirtyMax[i];
+        SSD1306_DirtyMin[i] = SSD1306_WIDTH;
+        SSD1306_DirtyMax[i] = 0;
+        if (!SSD1306_TxBusy) {
+            SSD1306_TxBusy = true;
+            SSD1306_TxStart = SSD1306_BusBytes;
+            SSD1306_TxSaved = 0;
+        }
+    }
+    SSD1306_Stats.frames++;
+}
+
+static inline uint32_t ssd1306_Word(const uint8_t *data)
+{
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// Number of leading bytes in [from, to] equal in the back and front buffers,
+// compared a word at a time
+static uint8_t ssd1306_SameLen(uint16_t from, uint16_t to)
+{
+    uint16_t i = from;
+
+    while (i <= to && (i & 0x3)) {
+        if (SSD1306_Buffer[i] != SSD1306_Front[i]) return i - from;
+        i++;
+    }
+    while (i + 3 <= to && ssd1306_Word(&SSD1306_Buffer[i]) == ssd1306_Word(&SSD1306_Front[i])) {
+        i += 4;
+    }
+    while (i <= to && SSD1306_Buffer[i] == SSD1306_Front[i]) i++;
+    return i - from;
+}
+
+// Length of the changed run starting at from, up to max bytes. Unchanged gaps
+// shorter than SSD1306_TX_GAP are included, they are cheaper than re-addressing.
+static uint8_t ssd1306_DiffLen(uint16_t from, uint16_t to, uint8_t max)
+{
+    uint16_t end = from;
+
+    for (uint16_t i = from; i <= to && i - from < max; ) {
+        if (SSD1306_Buffer[i] != SSD1306_Front[i]) {
+            end = i++;
+            continue;
+        }
+        uint8_t same = ssd1306_SameLen(i, to);
+        if (i + same > to || same >= SSD1306_TX_GAP) break;
+        i += same;
+    }
+    return end - from + 1;
+}
+
+// Send the next chunk of the queued transfer, at most SSD1306_TX_CHUNK bytes of
+// display RAM, so the caller is never blocked for a whole frame.
+// Returns true while the transfer is not finished.
+bool ssd1306_Process(void)
+{
+    uint8_t page = SSD1306_TxPage;
+    uint8_t len, column;
+    uint32_t start_bytes = SSD1306_BusBytes;
+
+    if (!SSD1306_TxBusy) return false;
+    for (uint8_t i = 0; SSD1306_TxMin[page] > SSD1306_TxMax[page]; i++) {
+        if (i == SSD1306_PAGES) {
+            SSD1306_TxBusy = false;
+            SSD1306_Stats.bytes_last = SSD1306_BusBytes - SSD1306_TxStart;
+            SSD1306_Stats.bytes_total += SSD1306_Stats.bytes_last;
+            SSD1306_Stats.saved_last = SSD1306_TxSaved;
+            SSD1306_Stats.saved_total += SSD1306_TxSaved;
+            return false;
+        }
+        page = (page + 1) % SSD1306_PAGES;
+        SSD1306_TxAddressed = false;
+    }
+    SSD1306_TxPage = page;
+
+    uint16_t offset = SSD1306_WIDTH*page;
+    if (SSD1306_FrontValid) {
+        uint8_t same = ssd1306_SameLen(offset + SSD1306_TxMin[page], offset + SSD1306_TxMax[page]);
+        if (same) {
+            SSD1306_TxSaved += same;
+            SSD1306_TxMin[page] += same;
+            SSD1306_TxAddressed = false;
+        }
+        if (SSD1306_TxMin[page] > SSD1306_TxMax[page]) {
+            SSD1306_TxMin[page] = SSD1306_WIDTH;
+            SSD1306_TxMax[page] = 0;
+            return true;
+        }
+        len = ssd1306_DiffLen(offset + SSD1306_TxMin[page], offset + SSD1306_TxMax[page], SSD1306_TX_CHUNK);
+    } else {
+        len = SSD1306_TxMax[page] - SSD1306_TxMin[page] + 1;
+        if (len > SSD1306_TX_CHUNK) len = SSD1306_TX_CHUNK;
     }
+
+    if (!SSD1306_TxAddressed) {
+        column = SSD1306_TxMin[page] + SSD1306_XSHIFT;
+        ssd1306_WriteCommand(PAGESTARTADDRESS + page);
+        ssd1306_WriteCommand(SETLOWCOLUMN | (column & 0xF));
+        ssd1306_WriteCommand(SETHIGHCOLUMN | (column >> 4));
+        SSD1306_TxAddressed = true;
+    }
+    ssd1306_WriteData(&SSD1306_Buffer[offset + SSD1306_TxMin[page]], len);
+    memcpy(&SSD1306_Front[offset + SSD1306_TxMin[page]], &SSD1306_Buffer[offset + SSD1306_TxMin[page]], len);
+    SSD1306_TxMin[page] += len;
+    if (SSD1306_TxMin[page] > SSD1306_TxMax[page]) {
+        SSD1306_TxMin[page] = SSD1306_WIDTH;
+        SSD1306_TxMax[page] = 0;
+    }
+
+    SSD1306_Stats.chunks++;
+    if (SSD1306_BusBytes - start_bytes > SSD1306_Stats.chunk_max) {
+        SSD1306_Stats.chunk_max = SSD1306_BusBytes - start_bytes;
+    }
+    return true;
+}
+
+// Queue the changed parts of the screenbuffer and wait until they are sent
+void ssd1306_Flush(void)
+{
+    ssd1306_UpdateScreen();
+    while (ssd1306_Process());
 }
 
 void ssd1306_Fill(SSD1306_COLOR color)
@@ -65,6 +213,14 @@ void ssd1306_Fill(SSD1306_COLOR color)
     for(i = 0; i < sizeof(SSD1306_Buffer); i++) {
         SSD1306_Buffer[i] = (color == OLED_BLACK) ? 0x00 : 0xFF;
     }
+    for(i = 0; i < SSD1306_PAGES; i++) {
+        ssd1306_MarkDirty(i, 0, SSD1306_WIDTH-1);
+    }
+}
+
+void ssd1306_GetStats(ssd1306_stats_t *stats)
+{
+    if (stats) *stats = SSD1306_Stats;
 }
 
 void ssd1306_SetContrast(uint8_t contrast)
@@ -109,9 +265,11 @@ bool ssd1306_Init(uint8_t contrast)
   ssd1306_WriteCommand(0x30|0); //--set pump voltage
   ssd1306_WriteCommand(DCDCCTRLMODESET);
   ssd1306_WriteCommand(DCDCSETON); //--set DC-DC enable
-  // Clear screen
+  // Clear screen, the display RAM content is unknown until then
+  SSD1306_FrontValid = false;
   ssd1306_Fill(OLED_BLACK);
-  ssd1306_UpdateScreen();
+  ssd1306_Flush();
+  SSD1306_FrontValid = true;
   ssd1306_WriteCommand(DISPLAYON); //--turn on SSD1306 panel
   return true;
 }
@@ -131,4 +289,60 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color)
   } else{
     SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
   }
+  ssd1306_MarkDirty(y / 8, x, x);
+}
+
+// Draw page-major image data: (h+7)/8 rows of w column bytes, bit 0 is the top pixel.
+// Each source byte is shifted to y and written into one or two buffer pages.
+void ssd1306_Blit(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const uint8_t *data, SSD1306_BLIT_MODE mode)
+{
+  uint8_t shift = y % 8;
+  uint8_t rows = (h + 7) / 8;
+
+  if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT || !w || !h) {
+    return;
+  }
+  uint8_t cols = (w > SSD1306_WIDTH - x) ? SSD1306_WIDTH - x : w;
+
+  for (uint8_t row = 0; row < rows; row++, data += w) {
+    uint8_t bits = h - row*8;
+    uint16_t mask = (bits >= 8) ? 0xFF : (1 << bits) - 1;
+    uint8_t page = y/8 + row;
+
+    for (uint8_t half = 0; half < 2; half++, page++) {
+      uint8_t page_mask = (half == 0) ? (mask << shift) : (mask >> (8 - shift));
+      if (page >= SSD1306_PAGES || !page_mask) break;
+
+      uint8_t *dst = &SSD1306_Buffer[page*SSD1306_WIDTH + x];
+      int16_t changed_min = -1, changed_max = -1;
+      for (uint8_t i = 0; i < cols; i++) {
+        uint8_t val = (half == 0) ? (data[i] << shift) : (data[i] >> (8 - shift));
+        uint8_t out;
+        switch (mode) {
+        case BLIT_SET:
+          out = dst[i] | (val & page_mask);
+          break;
+        case BLIT_CLEAR:
+          out = dst[i] & ~(val & page_mask);
+          break;
+        case BLIT_COPY_INV:
+          val = ~val;
+          // fall through
+        default:
+          out = (dst[i] & ~page_mask) | (val & page_mask);
+          break;
+        }
+        if (out != dst[i]) {
+          dst[i] = out;
+          if (changed_min < 0) changed_min = i;
+          changed_max = i;
+        }
+      }
+      // Only columns whose content changed have to be sent
+      if (changed_min >= 0) {
+        ssd1306_MarkDirty(page, x + changed_min, x + changed_max);
+      }
+      if (!shift) break;
+    }
+  }
 }
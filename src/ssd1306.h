@@ -57,6 +57,9 @@ extern "C" {
 #define SSD1306_HEIGHT          64
 #define SSD1306_WIDTH           128
 #define SSD1306_XSHIFT          2
+#define SSD1306_PAGES           (SSD1306_HEIGHT / 8)
+#define SSD1306_TX_CHUNK        64  // display RAM bytes per ssd1306_Process call, ~1.6 ms at 400 kHz
+#define SSD1306_TX_GAP          9   // unchanged bytes sent rather than re-addressing (3 commands)
 
 // Enumeration for screen colors
 typedef enum {
@@ -64,13 +67,36 @@ typedef enum {
     OLED_WHITE = 0x01  // Pixel is set. Color depends on OLED
 } SSD1306_COLOR;
 
+// Blit modes, applied to the pixels covered by the source image
+typedef enum {
+    BLIT_SET,       // set pixels which are set in the source
+    BLIT_CLEAR,     // clear pixels which are set in the source
+    BLIT_COPY,      // copy the source
+    BLIT_COPY_INV,  // copy the inverted source
+} SSD1306_BLIT_MODE;
+
+// Display update counters
+typedef struct {
+    uint32_t frames;        // ssd1306_UpdateScreen calls
+    uint32_t bytes_total;   // I2C bytes sent by all frames
+    uint16_t bytes_last;    // I2C bytes sent by the last transfer
+    uint32_t chunks;        // ssd1306_Process calls which sent data
+    uint16_t chunk_max;     // I2C bytes of the largest chunk
+    uint32_t saved_total;   // queued display RAM bytes skipped as unchanged
+    uint16_t saved_last;    // display RAM bytes skipped by the last transfer
+} ssd1306_stats_t;
+
 // Procedure definitions
 bool ssd1306_Init(uint8_t contrast);
 void ssd1306_SetContrast(uint8_t contrast);
 void ssd1306_PowerDown(void);
 void ssd1306_Fill(SSD1306_COLOR color);
 void ssd1306_UpdateScreen(void);
+bool ssd1306_Process(void);
+void ssd1306_Flush(void);
 void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
+void ssd1306_Blit(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const uint8_t *data, SSD1306_BLIT_MODE mode);
+void ssd1306_GetStats(ssd1306_stats_t *stats);
 
 // Low-level procedures
 void ssd1306_Reset(void);
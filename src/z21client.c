@@ -33,19 +33,6 @@ typedef struct {
   uint16_t ProgVoltage;      //mV
 }config_t;
 
-#define Z21_BC_NONE         0x00000000
-#define Z21_BC_ALL          0x00000001
-#define Z21_BC_RBUS         0x00000002
-#define Z21_BC_RAILCOM      0x00000004
-#define Z21_BC_SYSINFO      0x00000100
-#define Z21_BC_NETALL       0x00010000
-#define Z21_BC_LN           0x01000000
-#define Z21_BC_LN_LOCOS     0x02000000
-#define Z21_BC_LN_SWITCHES  0x04000000
-#define Z21_BC_LN_GBM       0x08000000
-#define Z21_BC_RAILCOM_ALL  0x00040000
-#define Z21_BC_CANDETECTOR  0x00080000
-
 #define DCCSTEP14       0x01
 #define DCCSTEP28       0x02
 #define DCCSTEP128      0x03
@@ -64,8 +51,92 @@ typedef struct {
 #define XNET_DATA_7   7  //Data uint8_t 7
 #define XNET_BUF_SIZE 8
 
-static const uint16_t func_group_mask[] = {0x0F,0xFF,0xFF,0xFF};
-static const uint8_t func_group_shift[] = {1,5,13,21};
+#define LOCO_INFO_MIN_LEN   10  //X-Header, DB0-DB7 and XOR
+#define LOCO_INFO_F29_LEN   11  //DB8 with F29-F31 is sent by newer firmware
+#define LOCO_INFO_BUSY      0x08
+#define LOCO_INFO_STEPS     0x07
+#define LOCO_INFO_MULTI     0x40
+#define LOCO_INFO_SEARCH    0x20
+#define LOCO_INFO_F0        0x10
+#define LOCO_INFO_F1_F4     0x0F
+
+#define CMD_INFLIGHT_MAX    8     //commands awaiting the response at once
+#define CMD_DATA_MAX        6     //longest tracked XpressNet command
+#define CMD_TIMEOUT_LOCO    150   //ms to the first retransmission, doubled on every retry
+#define CMD_TIMEOUT_TRNT    150
+#define CMD_TIMEOUT_CV      2000  //programming track commands take a while
+#define CMD_RETRIES_LOCO    3
+#define CMD_RETRIES_TRNT    2
+#define CMD_RETRIES_CV      1
+
+#define POLL_MISSES_MAX     3     //missed status replies in a row before logging in again
+
+#define SPEED_SLOTS         4     //locos with the coalesced speed at once
+#define SPEED_PACING        200   //ms between two speed frames of one loco awaiting the response
+#define XNET_MSG_MAX        (LAN_HEADER_LEN + 9 + 1)  //longest command with the LAN header and XOR
+
+/* Command sent to the command station and not yet confirmed. Matching is done
+ * by the command type and the key (loco or turnout address, CV number), a new
+ * command with the same type and key replaces the pending one. */
+typedef struct {
+    bool used;
+    bool released;                  //turnout: deactivation already sent
+    uint8_t type;                   //z21client_cmd_t
+    uint8_t retries;
+    uint8_t len;
+    uint16_t key;
+    uint32_t sent;                  //time of the first transmission
+    uint32_t due;                   //time of the next retransmission
+    uint8_t data[CMD_DATA_MAX];     //XpressNet data without XOR for the retransmission
+} inflight_t;
+
+typedef struct {
+    uint16_t timeout;
+    uint8_t retries;
+} cmd_conf_t;
+
+static const cmd_conf_t cmd_conf[Z21_CMD_NUM] = {
+    [Z21_CMD_SPEED]   = {CMD_TIMEOUT_LOCO, CMD_RETRIES_LOCO},
+    [Z21_CMD_FUNC]    = {CMD_TIMEOUT_LOCO, CMD_RETRIES_LOCO},
+    [Z21_CMD_TURNOUT] = {CMD_TIMEOUT_TRNT, CMD_RETRIES_TRNT},
+    [Z21_CMD_CV]      = {CMD_TIMEOUT_CV, CMD_RETRIES_CV},
+};
+
+/* Outgoing speed of one loco. While the previous frame is not confirmed and
+ * the pacing interval is not over only the newest speed is kept. */
+typedef struct {
+    bool used;
+    bool pending;
+    uint8_t steps;
+    uint8_t speed;
+    uint8_t sent_speed;
+    uint16_t addr;
+    uint32_t sent;
+} speed_slot_t;
+
+static uint8_t tx_buf[Z21_TX_MAX_SIZE];     //datagram being built
+static uint16_t tx_len;                     //bytes in tx_buf
+static uint16_t tx_msg;                     //start of the message being built
+static uint8_t tx_xor;
+static uint8_t tx_batch;                    //nesting of z21Client_beginBatch()
+static inflight_t inflight[CMD_INFLIGHT_MAX];
+static speed_slot_t speed_slots[SPEED_SLOTS];
+static z21client_cmd_stats_t cmd_stats[Z21_CMD_NUM];
+static uint32_t z21_now;
+
+static uint32_t bc_flags;                   //broadcast flags confirmed by the command station
+static uint16_t subscribed_loco;            //LAN_X_GET_LOCO_INFO sent for it, 0 for none
+static z21client_session_t session;
+static uint32_t last_tx, last_rx;           //z21_now of the last datagram sent and received
+static uint32_t poll_interval = Z21_STATUS_PERIOD;
+static uint32_t poll_count;
+static uint32_t poll_sent;
+static bool poll_pending;
+static uint8_t poll_misses;
+static uint8_t power_status = CS_NORMAL;
+
+static uint8_t trnt_known[Z21_TURNOUT_CACHE / 8];   //position reported by the command station
+static uint8_t trnt_pos[Z21_TURNOUT_CACHE / 8];     //P=1, valid when known
 
 static bool inServiceMode = false;
 static bool programmingActive = false;
@@ -73,220 +144,338 @@ static bool programmingActive = false;
 static z21client_callback_t mXpressNetCallback;
 static dataCallback_t mSendDataCallback;
 
-static bool sendXNetData(uint8_t *data, uint8_t len);
-static void getXOR (uint8_t *data, uint8_t size);
-static bool checkXOR (uint8_t *data, uint8_t size);
-static int getFuncState(uint8_t group, uint8_t funcByte);
-static int getFuncMask(uint8_t group);
+static void lanBegin(uint16_t header);
+static bool lanSend(void);
+static void xnetBegin(void);
+static void lanPut(uint8_t data);
+static void xnetPut(uint8_t data);
+static bool xnetSend(void);
+static bool xnetSendCopy(const uint8_t *data, uint8_t len);
+static bool checkXOR (const uint8_t *data, uint16_t size);
+static bool sendTracked(z21client_cmd_t type, uint16_t key);
+static void cmdConfirmed(z21client_cmd_t type, uint16_t key, bool anyKey);
+static void locoCmdConfirmed(const z21client_loco_info_t *info);
 
 //--------------------------------------------------------------------------------------------
-static void ParseXNetMsg(uint8_t *XNetMsg, uint8_t len){
-    if (checkXOR(XNetMsg, len)) {
-        switch (XNetMsg[XNET_HEADER]) {
-            case 0x61:  //Broadcast
-                switch (XNetMsg[XNET_DATA_1]){
-                    case 0x00: // Track power off
-                        if (mXpressNetCallback.notifyXNetPower) mXpressNetCallback.notifyXNetPower(CS_TRACK_OFF);
-                        break;
-                    case 0x01: // Normal Operation Resumed
-                        if (mXpressNetCallback.notifyXNetPower) mXpressNetCallback.notifyXNetPower(CS_NORMAL);
-                        break;
-                    case 0x02: // Service Mode Entry
-                        inServiceMode = true;
-                        if (mXpressNetCallback.notifyXNetPower) mXpressNetCallback.notifyXNetPower(CS_SERV_MODE);
-                        break;
-                    case 0x08: // Track Short
-                        if (mXpressNetCallback.notifyXNetPower) mXpressNetCallback.notifyXNetPower(CS_TRACK_SHORTED);
-                        break;
-                    case 0x12: // Service mode: short circuit
-                        if (programmingActive) {
-                            if (mXpressNetCallback.notifyXNetServiceError)
-                                mXpressNetCallback.notifyXNetServiceError();
-                            if (inServiceMode)
-                                z21Client_setPower(CS_NORMAL);
-                            }
-                        break;
-                    case 0x13: // Service mode: no ACK
-                        if (programmingActive) {
-                            if (mXpressNetCallback.notifyXNetServiceError)
-                                mXpressNetCallback.notifyXNetServiceError();
-                            if (inServiceMode)
-                                z21Client_setPower(CS_NORMAL);
-                            programmingActive = false;
-                        }
-                        break;
-                    case 0x80: //Transfer error
-
-                        break;
-                    case 0x81: //Command station busy
-
-                        break;
-                    case 0x82: //Instruction not supported
-
-                        break;
-                }
-            case 0x62: //Command status response
-                if ((XNetMsg[XNET_DATA_1] == 0x22) && mXpressNetCallback.notifyXNetPower) {
-                    uint8_t status = 0;
-                    if ((XNetMsg[XNET_DATA_2] & 0x04) != 0) // Track Short
-                      status |= CS_TRACK_SHORTED;
-                    else if ((XNetMsg[XNET_DATA_2] & 0x20) != 0) // Service Mode
-                      status |= CS_SERV_MODE;
-                    else if ((XNetMsg[XNET_DATA_2] & 0x02) != 0) // Track off
-                      status |= CS_TRACK_OFF;
-                    else if ((XNetMsg[XNET_DATA_2] & 0x01) != 0) // Emergency stop
-                      status |= CS_ESTOP;
-                    mXpressNetCallback.notifyXNetPower(status);
-                }
-                break;
-            case 0x64: { //Service mode response
-                if (XNetMsg[XNET_DATA_1] == 0x14) {
-                    if (programmingActive) {
-                        uint16_t CV = ((XNetMsg[XNET_DATA_2]<<8) + XNetMsg[XNET_DATA_3]) + 1;
-                        uint8_t value = XNetMsg[XNET_DATA_4];
-                        if (mXpressNetCallback.notifyXNetService) mXpressNetCallback.notifyXNetService(true,CV,value);
-                        if (inServiceMode && programmingActive)
-                            z21Client_setPower(CS_NORMAL);
-                        programmingActive = false;
-                    }
-                }
-                break;
-            }
-            case 0x81: //Emergency Stop
-                if ((XNetMsg[XNET_DATA_1] == 0x00) && mXpressNetCallback.notifyXNetPower) {
-                    mXpressNetCallback.notifyXNetPower(CS_ESTOP);
-                }
-                break;
-            case 0xEF: {
-              uint16_t address = (((XNetMsg[XNET_DATA_1]&0x3F)<<8) + XNetMsg[XNET_DATA_2]);
-              uint8_t steps;
-              uint8_t speed = XNetMsg[XNET_DATA_4];
-              switch (XNetMsg[XNET_DATA_3]) {
-                case 0:
-                  steps = 14;
-                  break;
-                case 2:
-                  steps = 28;
-                  break;
-                case 4:
-                  steps = 128;
-                  break;
-                default:
-                  steps = 28;
-                  break;
-              }
-              if (mXpressNetCallback.notifyXNetExtSpeed)
-                  mXpressNetCallback.notifyXNetExtSpeed(address,steps,speed);
-              if (mXpressNetCallback.notifyXNetExtFunc) {
-                  mXpressNetCallback.notifyXNetExtFunc(address,1+getFuncMask(0),
-                                (((XNetMsg[XNET_DATA_5]&0x10)>>4) + getFuncState(0,XNetMsg[XNET_DATA_5])));
-                  for (uint8_t funcGroup=1; funcGroup<4; funcGroup++) {
-                      mXpressNetCallback.notifyXNetExtFunc(address,getFuncMask(funcGroup), getFuncState(funcGroup,XNetMsg[XNET_DATA_5+funcGroup]));
-                  }
-              }
-            }
-            default:
-                break;
-        }
-#if 0
-        if ((XNetMsg[XNET_HEADER] >= 0x42) && (XNetMsg[XNET_HEADER] <= 0x4E)){
-            if (!mXpressNetCallback.notifyXNetFeedback) return;
-            uint8_t size = (XNetMsg[XNET_HEADER]&0xF);
-            for (uint8_t i=0; i < size; i+=2){
-                if ((XNetMsg[size+2] & 0x10) != 0){
-                    mXpressNetCallback.notifyXNetFeedback(XNetMsg[size+1], 0xF0,  ((XNetMsg[size+2] & 0x0F) << 4));
-                }else {
-                    mXpressNetCallback.notifyXNetFeedback(XNetMsg[size + 1],  0x0F,  (XNetMsg[size + 2] & 0x0F));
-                }
-            }
+/* Handlers of the received XpressNet messages. XNetMsg points to the X-Header,
+ * len includes the XOR byte and is already checked against the table. */
+/* The status poll follows a power or short event closely until it settles */
+static void powerStatus(uint8_t status)
+{
+    if (status != power_status) {
+        power_status = status;
+        poll_interval = Z21_STATUS_PERIOD;
+    }
+    if (mXpressNetCallback.notifyXNetPower) mXpressNetCallback.notifyXNetPower(status);
+}
+
+static void onPower(const uint8_t *XNetMsg, uint16_t len, uint8_t status)
+{
+    if (status == CS_SERV_MODE) inServiceMode = true;
+    powerStatus(status);
+}
+
+static void onStatusChanged(const uint8_t *XNetMsg, uint16_t len, uint8_t arg)
+{
+    uint8_t status = 0;
+    if ((XNetMsg[XNET_DATA_2] & 0x04) != 0) // Track Short
+      status |= CS_TRACK_SHORTED;
+    else if ((XNetMsg[XNET_DATA_2] & 0x20) != 0) // Service Mode
+      status |= CS_SERV_MODE;
+    else if ((XNetMsg[XNET_DATA_2] & 0x02) != 0) // Track off
+      status |= CS_TRACK_OFF;
+    else if ((XNetMsg[XNET_DATA_2] & 0x01) != 0) // Emergency stop
+      status |= CS_ESTOP;
+    powerStatus(status);
+}
+
+/* Service mode short circuit or no ACK, arg tells if the programming is over */
+static void onServiceError(const uint8_t *XNetMsg, uint16_t len, uint8_t arg)
+{
+    cmdConfirmed(Z21_CMD_CV, 0, true);
+    if (programmingActive) {
+        if (mXpressNetCallback.notifyXNetServiceError)
+            mXpressNetCallback.notifyXNetServiceError();
+        if (inServiceMode)
+            z21Client_setPower(CS_NORMAL);
+        if (arg) programmingActive = false;
+    }
+}
+
+static void onCvResult(const uint8_t *XNetMsg, uint16_t len, uint8_t arg)
+{
+    cmdConfirmed(Z21_CMD_CV, 0, true);
+    if (programmingActive) {
+        uint16_t CV = ((XNetMsg[XNET_DATA_2]<<8) + XNetMsg[XNET_DATA_3]) + 1;
+        uint8_t value = XNetMsg[XNET_DATA_4];
+        if (mXpressNetCallback.notifyXNetService) mXpressNetCallback.notifyXNetService(true,CV,value);
+        if (inServiceMode)
+            z21Client_setPower(CS_NORMAL);
+        programmingActive = false;
+    }
+}
+
+static void onLocoInfo(const uint8_t *XNetMsg, uint16_t len, uint8_t arg)
+{
+    z21client_loco_info_t info;
+    if (!z21Client_decodeLocoInfo(XNetMsg, len, &info)) return;
+    locoCmdConfirmed(&info);
+    if (mXpressNetCallback.notifyXNetLocoInfo)
+        mXpressNetCallback.notifyXNetLocoInfo(&info);
+    if (mXpressNetCallback.notifyXNetExtSpeed)
+        mXpressNetCallback.notifyXNetExtSpeed(info.addr, info.steps, info.speed);
+    if (mXpressNetCallback.notifyXNetExtFunc)
+        mXpressNetCallback.notifyXNetExtFunc(info.addr, info.func_mask, info.func);
+    if (mXpressNetCallback.notifyXNetExtControl)
+        mXpressNetCallback.notifyXNetExtControl(info.addr, info.busy);
+}
+
+/* Answer to a request or broadcast, DB2 is 000000ZZ: 00 not switched yet,
+ * 01 P=0, 10 P=1 */
+static void onTurnoutInfo(const uint8_t *XNetMsg, uint16_t len, uint8_t arg)
+{
+    uint16_t address = (XNetMsg[XNET_DATA_1]<<8) + XNetMsg[XNET_DATA_2];
+    uint8_t position = XNetMsg[XNET_DATA_3] & 0x03;
+
+    cmdConfirmed(Z21_CMD_TURNOUT, address, false);
+    if (address < Z21_TURNOUT_CACHE) {
+        uint8_t mask = 1 << (address & 0x07);
+        if ((position == 0x01) || (position == 0x02)) {
+            trnt_known[address >> 3] |= mask;
+            if (position == 0x02) trnt_pos[address >> 3] |= mask;
+            else trnt_pos[address >> 3] &= ~mask;
+        } else trnt_known[address >> 3] &= ~mask;   //asked again by turnout_query()
+    }
+    if (mXpressNetCallback.notifyXNetFeedback)
+        mXpressNetCallback.notifyXNetFeedback(address, 0x03, position);
+}
+
+/* Received XpressNet messages. The entries of one X-Header must be adjacent,
+ * xnet_first[] points to the first of them. Messages not listed are ignored,
+ * e.g. 0x61 0x80-0x82 (transfer error, busy, not supported). */
+enum {
+    XNET_BC_TRACK_OFF,
+    XNET_BC_TRACK_ON,
+    XNET_BC_SERVICE_MODE,
+    XNET_BC_TRACK_SHORT,
+    XNET_CV_NACK_SC,
+    XNET_CV_NACK,
+    XNET_STATUS_CHANGED,
+    XNET_CV_RESULT,
+    XNET_BC_STOPPED,
+    XNET_TURNOUT_INFO,
+    XNET_LOCO_INFO,
+    XNET_MSG_NUM
+};
+
+#define XNET_DB0_ANY  0xFF  //the handler takes every DB0
+
+typedef struct {
+    uint8_t header;     //X-Header
+    uint8_t db0;        //DB0 or XNET_DB0_ANY
+    uint8_t min_len;    //X-Header to XOR inclusive
+    uint8_t arg;        //passed to the handler
+    void (*handler)(const uint8_t *XNetMsg, uint16_t len, uint8_t arg);
+} xnet_msg_t;
+
+static const xnet_msg_t xnet_msgs[XNET_MSG_NUM] = {
+    [XNET_BC_TRACK_OFF]    = {0x61, 0x00, 3, CS_TRACK_OFF, onPower},
+    [XNET_BC_TRACK_ON]     = {0x61, 0x01, 3, CS_NORMAL, onPower},
+    [XNET_BC_SERVICE_MODE] = {0x61, 0x02, 3, CS_SERV_MODE, onPower},
+    [XNET_BC_TRACK_SHORT]  = {0x61, 0x08, 3, CS_TRACK_SHORTED, onPower},
+    [XNET_CV_NACK_SC]      = {LAN_X_CV_NACK_SC, 0x12, 3, false, onServiceError},
+    [XNET_CV_NACK]         = {LAN_X_CV_NACK, 0x13, 3, true, onServiceError},
+    [XNET_STATUS_CHANGED]  = {0x62, 0x22, 4, 0, onStatusChanged},
+    [XNET_CV_RESULT]       = {LAN_X_CV_RESULT, 0x14, 6, 0, onCvResult},
+    [XNET_BC_STOPPED]      = {0x81, 0x00, 3, CS_ESTOP, onPower},
+    [XNET_TURNOUT_INFO]    = {LAN_X_TURNOUT_INFO, XNET_DB0_ANY, 5, 0, onTurnoutInfo},
+    [XNET_LOCO_INFO]       = {LAN_X_LOCO_INFO, XNET_DB0_ANY, LOCO_INFO_MIN_LEN, 0, onLocoInfo},
+};
+
+//Index of the first entry + 1 for every X-Header, 0 when there is none
+static const uint8_t xnet_first[256] = {
+    [0x61]               = XNET_BC_TRACK_OFF + 1,
+    [0x62]               = XNET_STATUS_CHANGED + 1,
+    [LAN_X_CV_RESULT]    = XNET_CV_RESULT + 1,
+    [0x81]               = XNET_BC_STOPPED + 1,
+    [LAN_X_TURNOUT_INFO] = XNET_TURNOUT_INFO + 1,
+    [LAN_X_LOCO_INFO]    = XNET_LOCO_INFO + 1,
+};
+
+static void ParseXNetMsg(const uint8_t *XNetMsg, uint16_t len){
+    if (len < 2) return;
+    if (!checkXOR(XNetMsg, len)) {
+        LOG_ERR("Wrong XOR\n\r");
+        return;
+    }
+    uint8_t first = xnet_first[XNetMsg[XNET_HEADER]];
+    if (!first) return;
+    for (const xnet_msg_t *msg = &xnet_msgs[first - 1];
+         (msg < &xnet_msgs[XNET_MSG_NUM]) && (msg->header == XNetMsg[XNET_HEADER]); msg++) {
+        if (msg->db0 != XNET_DB0_ANY) {
+            if (len < 3) return;
+            if (msg->db0 != XNetMsg[XNET_DATA_1]) continue;
         }
-#endif
-    } else {
-      LOG_ERR("Wrong XOR\n\r");
+        if (len >= msg->min_len) msg->handler(XNetMsg, len, msg->arg);
+        return;
     }
 }
 
 //--------------------------------------------------------------------------------------------
 bool z21Client_setPower(uint8_t power)
 {
-    bool ret = false;
-
+    xnetBegin();
     switch (power) {
-        case CS_NORMAL: {
-            //uint8_t PowerAn[] = {0x21, 0x81, 0xA0, 0x21, 0x81, 0xA0};
-            uint8_t PowerAn[] = {0x21, 0x81, 0xA0};
-            ret = sendXNetData(PowerAn, sizeof(PowerAn));
+        case CS_NORMAL:
+            xnetPut(LAN_X_GET_STATUS);
+            xnetPut(0x81);
             break;
-        }
-        case CS_ESTOP: {
-            //uint8_t EmStop[] = {0x80, 0x80, 0x80, 0x80};
-            uint8_t EmStop[] = {0x80, 0x80};
-            ret = sendXNetData(EmStop, sizeof(EmStop));
+        case CS_ESTOP:
+            xnetPut(0x80);
             break;
-        }
-        case CS_TRACK_OFF: {
-            //uint8_t PowerAus[] = {0x21, 0x80, 0xA1, 0x21, 0x80, 0xA1};
-            uint8_t PowerAus[] = {0x21, 0x80, 0xA1};
-            ret = sendXNetData(PowerAus, sizeof(PowerAus));
+        case CS_TRACK_OFF:
+            xnetPut(LAN_X_GET_STATUS);
+            xnetPut(0x80);
             break;
-        }
+        default:
+            return false;
     }
-    return ret;
+    return xnetSend();
 }
 
-bool z21Client_setSpeed(uint16_t locoAddress, uint8_t steps, uint8_t speed)
+static bool sendSpeed(uint16_t locoAddress, uint8_t steps, uint8_t speed)
 {
-    uint8_t LocoInfo[] = {LAN_X_SET_LOCO, 0x13, 0x00, 0x00, speed, 0x00};
-
+    xnetBegin();
+    xnetPut(LAN_X_SET_LOCO);
     switch (steps) {
-        case 14: LocoInfo[1] = 0x10; break;
-        case 28: LocoInfo[1] = 0x12; break;
-        //case 128: LocoInfo[1] = 0x13; break; //default to 128 Steps!
+        case 14: xnetPut(0x10); break;
+        case 28: xnetPut(0x12); break;
+        default: xnetPut(0x13); break; //default to 128 Steps!
     }
-    LocoInfo[2] = ((locoAddress >> 8) & 0x3F) | ((locoAddress >= 128) ? 0xC0 : 0x00);
-    LocoInfo[3] = locoAddress & 0xFF;
-    getXOR(LocoInfo, sizeof(LocoInfo));
-    return sendXNetData(LocoInfo, sizeof(LocoInfo));
+    xnetPut(((locoAddress >> 8) & 0x3F) | ((locoAddress >= 128) ? 0xC0 : 0x00));
+    xnetPut(locoAddress & 0xFF);
+    xnetPut(speed);
+    return sendTracked(Z21_CMD_SPEED, locoAddress);
+}
+
+static speed_slot_t * speedSlot(uint16_t locoAddress)
+{
+  speed_slot_t *idle = NULL;
+
+  for (uint8_t i=0; i<SPEED_SLOTS; i++) {
+    speed_slot_t *slot = &speed_slots[i];
+    if (slot->used && (slot->addr == locoAddress)) return slot;
+    if (!idle && (!slot->used || (!slot->pending && ((z21_now - slot->sent) >= SPEED_PACING)))) idle = slot;
+  }
+  return idle;
+}
+
+static bool flushSpeed(speed_slot_t *slot)
+{
+  slot->pending = false;
+  slot->sent = z21_now;
+  slot->sent_speed = slot->speed;
+  return sendSpeed(slot->addr, slot->steps, slot->speed);
+}
+
+static bool speedBusy(const speed_slot_t *slot)
+{
+  if (!slot->used || ((z21_now - slot->sent) >= SPEED_PACING)) return false;
+  for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+    if (inflight[i].used && (inflight[i].type == Z21_CMD_SPEED) && (inflight[i].key == slot->addr)) return true;
+  }
+  return false;
+}
+
+/* Speed changes of a held key are coalesced, the newest one is sent when the
+ * previous frame is confirmed or the pacing interval is over. Stop and
+ * emergency stop are never delayed. */
+bool z21Client_setSpeed(uint16_t locoAddress, uint8_t steps, uint8_t speed)
+{
+  speed_slot_t *slot = speedSlot(locoAddress);
+
+  if (!slot) return sendSpeed(locoAddress, steps, speed);
+  if (slot->used && (slot->addr == locoAddress) && slot->pending) cmd_stats[Z21_CMD_SPEED].coalesced++;
+  if (!slot->used || (slot->addr != locoAddress)) {
+    slot->used = true;
+    slot->addr = locoAddress;
+    slot->sent = z21_now - SPEED_PACING;
+  }
+  slot->steps = steps;
+  slot->speed = speed;
+  if (((speed & 0x7F) > 1) && speedBusy(slot)) {
+    slot->pending = (speed != slot->sent_speed);
+    return true;
+  }
+  return flushSpeed(slot);
 }
 
 bool z21Client_setLocoFunc(uint16_t locoAddress, uint8_t num, uint32_t funcStates)
 {
-    uint8_t LocoInfo[] = {LAN_X_SET_LOCO, LAN_X_SET_LOCO_FUNCTION, 0x00, 0x00, 0x00, 0x00};
     uint8_t stateByte = (funcStates>>num) & 0x1;
 
-    LocoInfo[2] = ((locoAddress >> 8) & 0x3F) | ((locoAddress >= 128) ? 0xC0 : 0x00);
-    LocoInfo[3] = locoAddress & 0xFF;
-    LocoInfo[4] = (num & 0x3F) | (stateByte<<6);
-    getXOR(LocoInfo, sizeof(LocoInfo));
-    return sendXNetData(LocoInfo, sizeof(LocoInfo));
+    xnetBegin();
+    xnetPut(LAN_X_SET_LOCO);
+    xnetPut(LAN_X_SET_LOCO_FUNCTION);
+    xnetPut(((locoAddress >> 8) & 0x3F) | ((locoAddress >= 128) ? 0xC0 : 0x00));
+    xnetPut(locoAddress & 0xFF);
+    xnetPut((num & 0x3F) | (stateByte<<6));
+    return sendTracked(Z21_CMD_FUNC, locoAddress);
 }
 
 bool z21Client_setTrntPos(uint16_t address, bool state, bool active)
 {
-    uint8_t TrntInfo[] = {LAN_X_SET_TURNOUT, 0x00, 0x00, 0x80, 0x00};
+    xnetBegin();
+    xnetPut(LAN_X_SET_TURNOUT);
+    xnetPut(address >> 8);
+    xnetPut(address & 0xFF);
+    xnetPut(0x80 | ((active ? 1: 0) << 3) | (state ? 1 : 0));
+    if (active) return sendTracked(Z21_CMD_TURNOUT, address);
+    //A retransmitted activation must be followed by the deactivation again
+    for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+        if (inflight[i].used && (inflight[i].type == Z21_CMD_TURNOUT) && (inflight[i].key == address))
+            inflight[i].released = true;
+    }
+    return xnetSend();
+}
+
+bool z21Client_requestTrntInfo(uint16_t address)
+{
+    xnetBegin();
+    xnetPut(LAN_X_GET_TURNOUT_INFO);
+    xnetPut(address >> 8);
+    xnetPut(address & 0xFF);
+    return xnetSend();
+}
 
-    TrntInfo[1] = (address >> 8);
-    TrntInfo[2] |= (address & 0xFF);
-    TrntInfo[3] |= (active ? 1: 0) << 3;
-    TrntInfo[3] |= state ? 1 : 0;
-    getXOR(TrntInfo, sizeof(TrntInfo));
-    return sendXNetData(TrntInfo, sizeof(TrntInfo));
+/* Cached position of the turnout, false when it is not known. The cache is
+ * filled by LAN_X_TURNOUT_INFO, broadcast while the session is online. */
+bool z21Client_getTrntPos(uint16_t address, bool *state)
+{
+    if ((address >= Z21_TURNOUT_CACHE) || !(trnt_known[address >> 3] & (1 << (address & 0x07))))
+        return false;
+    if (state) *state = (trnt_pos[address >> 3] & (1 << (address & 0x07))) != 0;
+    return true;
 }
 
 bool z21Client_requestStatus(void)
 {
-  uint8_t data[] = {LAN_X_GET_STATUS, 0x24, 0x05};
-  return sendXNetData(data, sizeof(data));
+  xnetBegin();
+  xnetPut(LAN_X_GET_STATUS);
+  xnetPut(0x24);
+  return xnetSend();
 }
 
 bool z21Client_setCV(uint16_t cv, uint8_t value) {
-    uint8_t cvInfo[] = {LAN_X_CV_WRITE, 0x12, 0x00, 0x00, value, 0x00};
     if (cv == 0) return false;
     cv--;
-    cvInfo[2] = cv>>8;
-    cvInfo[3] = cv&0xFF;
-    getXOR(cvInfo, sizeof(cvInfo));
-    if (sendXNetData(cvInfo, sizeof(cvInfo))){
+    xnetBegin();
+    xnetPut(LAN_X_CV_WRITE);
+    xnetPut(0x12);
+    xnetPut(cv>>8);
+    xnetPut(cv&0xFF);
+    xnetPut(value);
+    if (sendTracked(Z21_CMD_CV, cv)){
         programmingActive = true;
         return true;
     }
@@ -295,97 +484,433 @@ bool z21Client_setCV(uint16_t cv, uint8_t value) {
 
 bool z21Client_setPoMCV(uint16_t address, uint16_t cv, uint8_t value)
 {
-    uint8_t cvInfo[] = {LAN_X_CV_POM, LAN_X_CV_POM_IO, 0x00, 0x00, 0xEC, 0x00, value, 0x00};
     if (cv == 0) return false;
     cv--;
-    cvInfo[2] = address>>8;
-    cvInfo[3] = address&0xFF;
-    cvInfo[4] |= (cv>>8)&0x3; 
-    cvInfo[5] |= cv&0xFF; 
-    getXOR(cvInfo, sizeof(cvInfo));
-    if (sendXNetData(cvInfo, sizeof(cvInfo))){
-        return true;
-    }
-    return false;
+    xnetBegin();
+    xnetPut(LAN_X_CV_POM);
+    xnetPut(LAN_X_CV_POM_IO);
+    xnetPut(address>>8);
+    xnetPut(address&0xFF);
+    xnetPut(0xEC | ((cv>>8)&0x3));
+    xnetPut(cv&0xFF);
+    xnetPut(value);
+    return xnetSend();
 }
 
 bool z21Client_requestReadCV(uint16_t address){
-    uint8_t cvInfo[] = {LAN_X_CV_READ, 0x11, 0x00, 0x00, 0x00};
     if (address == 0) return false;
     address--;
-    cvInfo[2] = address>>8;
-    cvInfo[3] = address&0xFF;
-    getXOR(cvInfo, sizeof(cvInfo));
-    if (sendXNetData(cvInfo, sizeof(cvInfo))) {
+    xnetBegin();
+    xnetPut(LAN_X_CV_READ);
+    xnetPut(0x11);
+    xnetPut(address>>8);
+    xnetPut(address&0xFF);
+    if (sendTracked(Z21_CMD_CV, address)) {
         programmingActive = true;
         return true;
     }
     return false;
 }
 
-static void getXOR (uint8_t *data, uint8_t size) {
+static bool checkXOR(const uint8_t *data, uint16_t size) {
     uint8_t XOR = 0x00;
     for (uint16_t i = 0; i < size-1; i++) {
         XOR = (XOR ^ data[i]);
     }
-  data[size-1] = XOR;
+    return data[size-1] == XOR;
 }
 
-static bool checkXOR(uint8_t *data, uint8_t size) {
-    uint8_t XOR = 0x00;
-    for (uint16_t i = 0; i < size-1; i++) {
-        XOR = (XOR ^ data[i]);
+/* Decode LAN_X_LOCO_INFO starting at the X-Header, len includes the XOR byte:
+ * DB0-DB1 address, DB2 busy flag and speed steps, DB3 direction and speed,
+ * DB4 multi-unit, smart search, F0-F4, DB5-DB7 F5-F28, DB8 F29-F31 (optional) */
+bool z21Client_decodeLocoInfo(const uint8_t *XNetMsg, uint16_t len, z21client_loco_info_t *info)
+{
+    if ((len < LOCO_INFO_MIN_LEN) || (XNetMsg[XNET_HEADER] != LAN_X_LOCO_INFO)) return false;
+    const uint8_t *db = &XNetMsg[XNET_DATA_1];
+
+    info->addr = ((db[0] & 0x3F) << 8) + db[1];
+    switch (db[2] & LOCO_INFO_STEPS) {
+      case 0:
+        info->steps = 14;
+        break;
+      case 4:
+        info->steps = 128;
+        break;
+      default:
+        info->steps = 28;
+        break;
     }
-    return data[size-1] == XOR;
+    info->busy = (db[2] & LOCO_INFO_BUSY) != 0;
+    info->speed = db[3];
+    info->multi_unit = (db[4] & LOCO_INFO_MULTI) != 0;
+    info->smart_search = (db[4] & LOCO_INFO_SEARCH) != 0;
+    info->func = ((db[4] & LOCO_INFO_F0) ? 1 : 0) | ((uint32_t)(db[4] & LOCO_INFO_F1_F4) << 1) |
+                 ((uint32_t)db[5] << 5) | ((uint32_t)db[6] << 13) | ((uint32_t)db[7] << 21);
+    info->func_mask = 0x1FFFFFFF;
+    if (len >= LOCO_INFO_F29_LEN) {
+        info->func |= (uint32_t)(db[8] & 0x07) << 29;
+        info->func_mask |= 0xE0000000;
+    }
+    return true;
 }
+//////////////////////////////////////////////////////////////////////////////////////////////
+static bool txFlush(void)
+{
+  uint16_t len = tx_len;
 
-static int getFuncState(uint8_t group, uint8_t funcByte){
-    return (funcByte & func_group_mask[group]) << func_group_shift[group];
+  tx_len = 0;
+  if (!len || !mSendDataCallback) return false;
+  last_tx = z21_now;
+  mSendDataCallback(tx_buf, len);
+  return true;
 }
 
-static int getFuncMask(uint8_t group){
-    return func_group_mask[group] << func_group_shift[group];
+/* The outgoing LAN message is built in place in tx_buf in one pass: the header
+ * is fixed, the XOR is accumulated while the data is written and the length
+ * is filled in when the message is complete. In a batch the messages are
+ * appended to the datagram, which is sent when it would overflow. */
+static void lanBegin(uint16_t header)
+{
+  if (tx_len > sizeof(tx_buf) - XNET_MSG_MAX) txFlush();
+  tx_msg = tx_len;
+  tx_buf[tx_msg + 2] = header & 0xFF;
+  tx_buf[tx_msg + 3] = header >> 8;
+  tx_len += LAN_HEADER_LEN;
+  tx_xor = 0;
 }
-//////////////////////////////////////////////////////////////////////////////////////////////
-static void sendPacket(uint16_t dataLen, uint16_t header, uint8_t *data, bool withXOR)
-{
-  uint8_t packet[24];
-  uint8_t i, packetLen = dataLen + LAN_HEADER_LEN + (withXOR?1:0);
-
-  //Fill the packet structure
-  packet[0] = packetLen & 0xFF;
-  packet[1] = packetLen >> 8;
-  packet[2] = header & 0xFF;
-  packet[3] = header >> 8;
-  packet[packetLen - 1] = 0;
-  memcpy(packet + LAN_HEADER_LEN, data, dataLen);
-  if (withXOR)
-  {
-    for (i = 0; i < dataLen; i++)
-      packet[packetLen-1] ^= data[i];
+
+static bool lanSend(void)
+{
+  tx_buf[tx_msg] = tx_len - tx_msg;
+  tx_buf[tx_msg + 1] = 0;
+  if (!mSendDataCallback) {
+    tx_len = tx_msg;
+    return false;
   }
-  if (mSendDataCallback) mSendDataCallback(packet, packetLen);
+  return tx_batch ? true : txFlush();
+}
+
+static void xnetBegin(void)
+{
+  lanBegin(LAN_X_Header);
+}
+
+static void lanPut(uint8_t data)
+{
+  if (tx_len >= tx_msg + XNET_MSG_MAX - 1) return;
+  tx_buf[tx_len++] = data;
 }
 
-static bool sendXNetData(uint8_t *data, uint8_t len)
+static void xnetPut(uint8_t data)
 {
-  sendPacket(len, LAN_X_Header, data, false);
+  lanPut(data);
+  tx_xor ^= data;
+}
+
+static bool xnetSend(void)
+{
+  tx_buf[tx_len++] = tx_xor;
+  return lanSend();
+}
+
+/* Commands issued between begin and flush go out in as few datagrams as
+ * possible, e.g. function macros or a consist stop. Batches may nest, the
+ * outermost flush sends. */
+void z21Client_beginBatch(void)
+{
+  tx_batch++;
+}
+
+bool z21Client_flushBatch(void)
+{
+  if (!tx_batch || --tx_batch) return true;
+  return !tx_len || txFlush();
+}
+
+static bool xnetSendCopy(const uint8_t *data, uint8_t len)
+{
+  xnetBegin();
+  for (uint8_t i=0; i<len; i++) xnetPut(data[i]);
+  return xnetSend();
+}
+
+/* Send the command built in tx_buf and keep it until the expected response
+ * arrives. When the table is full the command is still sent, only without
+ * the retransmission. */
+static bool sendTracked(z21client_cmd_t type, uint16_t key)
+{
+  inflight_t *slot = NULL;
+  uint8_t len = tx_len - tx_msg - LAN_HEADER_LEN;
+
+  for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+    if (inflight[i].used && (inflight[i].type == type) && (inflight[i].key == key)) {
+      slot = &inflight[i];
+      break;
+    }
+    if (!slot && !inflight[i].used) slot = &inflight[i];
+  }
+  if (slot && (len <= CMD_DATA_MAX)) memcpy(slot->data, &tx_buf[tx_msg + LAN_HEADER_LEN], len);
+  if (!xnetSend()) return false;
+  cmd_stats[type].sent++;
+  if (slot && (len <= CMD_DATA_MAX)) {
+    slot->used = true;
+    slot->released = false;
+    slot->type = type;
+    slot->key = key;
+    slot->retries = 0;
+    slot->len = len;
+    slot->sent = z21_now;
+    slot->due = z21_now + cmd_conf[type].timeout;
+  }
   return true;
 }
 
-void z21Client_parseReceived(uint8_t* packet, uint8_t size)
+static void cmdAcked(inflight_t *cmd)
+{
+  z21client_cmd_stats_t *stats = &cmd_stats[cmd->type];
+  uint32_t latency = z21_now - cmd->sent;
+
+  if (latency > 0xFFFF) latency = 0xFFFF;
+  stats->acked++;
+  stats->latency_last = latency;
+  stats->latency_sum += latency;
+  if (latency > stats->latency_max) stats->latency_max = latency;
+  cmd->used = false;
+}
+
+static void cmdConfirmed(z21client_cmd_t type, uint16_t key, bool anyKey)
+{
+  for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+    inflight_t *cmd = &inflight[i];
+    if (cmd->used && (cmd->type == type) && (anyKey || (cmd->key == key))) cmdAcked(cmd);
+  }
+}
+
+/* LAN_X_LOCO_INFO is broadcast on any change of the loco, so it confirms the
+ * command only when it reports the requested speed or function state */
+static void locoCmdConfirmed(const z21client_loco_info_t *info)
+{
+  for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+    inflight_t *cmd = &inflight[i];
+    if (!cmd->used || (cmd->key != info->addr)) continue;
+    if (cmd->type == Z21_CMD_SPEED) {
+      if (cmd->data[4] == info->speed) cmdAcked(cmd);
+    } else if (cmd->type == Z21_CMD_FUNC) {
+      uint8_t num = cmd->data[4] & 0x3F, mode = cmd->data[4] >> 6;
+      if ((num >= NUM_OF_LOCO_FUNC) || (mode > 1) || (((info->func >> num) & 0x1) == mode)) cmdAcked(cmd);
+    }
+  }
+}
+
+/* Retransmit the commands which were not confirmed in time, the timeout is
+ * doubled on every retry. Must be called periodically with the time in ms. */
+void z21Client_process(uint32_t now)
+{
+  z21_now = now;
+  z21Client_beginBatch();
+  for (uint8_t i=0; i<CMD_INFLIGHT_MAX; i++) {
+    inflight_t *cmd = &inflight[i];
+    if (!cmd->used || ((int32_t)(now - cmd->due) < 0)) continue;
+    const cmd_conf_t *conf = &cmd_conf[cmd->type];
+    if (cmd->retries >= conf->retries) {
+      LOG_ERR("Z21 command timed out\n\r");
+      cmd_stats[cmd->type].failed++;
+      cmd->used = false;
+      continue;
+    }
+    if (cmd->type == Z21_CMD_SPEED) {
+      //Retransmit the newest speed instead of the obsolete one
+      speed_slot_t *slot = speedSlot(cmd->key);
+      if (slot && slot->used && (slot->addr == cmd->key) && slot->pending) {
+        flushSpeed(slot);
+        continue;
+      }
+    }
+    cmd->retries++;
+    cmd_stats[cmd->type].retries++;
+    cmd->due = now + ((uint32_t)conf->timeout << cmd->retries);
+    xnetSendCopy(cmd->data, cmd->len);
+    if (cmd->released) {
+      xnetBegin();
+      for (uint8_t n=0; n<cmd->len; n++) xnetPut((n == 3) ? (cmd->data[n] & ~0x08) : cmd->data[n]);
+      xnetSend();
+    }
+  }
+  for (uint8_t i=0; i<SPEED_SLOTS; i++) {
+    speed_slot_t *slot = &speed_slots[i];
+    if (slot->pending && !speedBusy(slot)) flushSpeed(slot);
+  }
+  z21Client_flushBatch();
+}
+
+void z21Client_getCmdStats(z21client_cmd_t type, z21client_cmd_stats_t *stats)
+{
+  if (type < Z21_CMD_NUM) *stats = cmd_stats[type];
+}
+
+static void sendSubscribe(uint16_t locoAddress)
 {
-  int header = (packet[3]<<8) + packet[2];
-  //uint32_t buffer[4];
-  //uint8_t * data = (uint8_t*)buffer;
+  xnetBegin();
+  xnetPut(LAN_X_GET_LOCO_INFO);
+  xnetPut(0xF0);
+  xnetPut(((locoAddress >> 8) & 0x3F) | ((locoAddress >= 128) ? 0xC0 : 0x00));
+  xnetPut(locoAddress & 0xFF);
+  xnetSend();
+}
+
+/* Ask the command station to push the broadcasts selected by the Z21_BC_*
+ * flags and read them back, z21Client_getBroadcastFlags() reports them once
+ * confirmed. The loco subscription is renewed in the same datagram. */
+bool z21Client_setBroadcastFlags(uint32_t flags)
+{
+  z21Client_beginBatch();
+  lanBegin(LAN_SET_BROADCASTFLAGS);
+  for (uint8_t i=0; i<4; i++) lanPut(flags >> (8*i));
+  lanSend();
+  lanBegin(LAN_GET_BROADCASTFLAGS);
+  lanSend();
+  if (subscribed_loco) sendSubscribe(subscribed_loco);
+  return z21Client_flushBatch();
+}
+
+uint32_t z21Client_getBroadcastFlags(void)
+{
+  return bc_flags;
+}
 
-  switch (header) {
-  case LAN_X_Header:
-    ParseXNetMsg(packet + LAN_HEADER_LEN, packet[0] - LAN_HEADER_LEN);
+/* Subscribe to LAN_X_LOCO_INFO of the loco, the command station keeps the
+ * subscriptions of the last few locos asked for. Asking for the same loco
+ * again sends nothing. */
+bool z21Client_subscribeLoco(uint16_t locoAddress)
+{
+  if (locoAddress == subscribed_loco) return true;
+  subscribed_loco = locoAddress;
+  if (!locoAddress) return true;
+  sendSubscribe(locoAddress);
+  return mSendDataCallback != NULL;
+}
+
+static void sessionPoll(void)
+{
+  poll_sent = z21_now;
+  poll_pending = true;
+  poll_count++;
+  z21Client_requestStatus();
+}
+
+static void sessionLogin(void)
+{
+  session = Z21_SESSION_LOGIN;
+  bc_flags = 0;
+  //Broadcasts may have been missed meanwhile
+  memset(trnt_known, 0, sizeof(trnt_known));
+  poll_interval = Z21_STATUS_PERIOD;
+  poll_misses = 0;
+  z21Client_beginBatch();
+  z21Client_setBroadcastFlags(Z21_BC_ALL);
+  sessionPoll();
+  z21Client_flushBatch();
+}
+
+/* Called every Z21_STATUS_PERIOD with the state of the WiFi link. Logs in by
+ * subscribing the broadcasts until they are confirmed. Once online the Z21
+ * pushes the state and the status poll is adaptive: it is skipped while
+ * frames are sent or received anyway, each answered poll doubles the interval
+ * up to Z21_KEEPALIVE, a missed reply or a power event brings it back to
+ * Z21_STATUS_PERIOD. POLL_MISSES_MAX missed replies in a row mean the session
+ * is lost, it logs in again. */
+void z21Client_sessionTick(bool linkUp)
+{
+  if (!linkUp) {
+    session = Z21_SESSION_OFFLINE;
+    bc_flags = 0;
+    return;
+  }
+  switch (session) {
+  case Z21_SESSION_OFFLINE:
+  case Z21_SESSION_LOGIN:
+    sessionLogin();
+    break;
+  case Z21_SESSION_ONLINE:
+    if (poll_pending) {
+      if ((int32_t)(last_rx - poll_sent) >= 0) {
+        poll_pending = false;
+        poll_misses = 0;
+        poll_interval = (poll_interval * 2 < Z21_KEEPALIVE) ? poll_interval * 2 : Z21_KEEPALIVE;
+      } else if ((z21_now - poll_sent) >= Z21_REPLY_TIMEOUT) {
+        poll_pending = false;
+        poll_interval = Z21_STATUS_PERIOD;
+        if (++poll_misses >= POLL_MISSES_MAX) {
+          LOG_ERR("Z21 session lost\n\r");
+          sessionLogin();
+          break;
+        }
+      }
+    }
+    //The Z21 needs to hear from the client, a fresh state only postpones it
+    if (!poll_pending && ((z21_now - last_tx) >= poll_interval) &&
+        (((z21_now - last_rx) >= poll_interval) || ((z21_now - last_tx) >= Z21_KEEPALIVE)))
+      sessionPoll();
     break;
   }
 }
 
+/* Tell the command station to drop the subscriptions, before the power down.
+ * The next z21Client_sessionTick() logs in again. */
+void z21Client_logoff(void)
+{
+  if (session == Z21_SESSION_OFFLINE) return;
+  lanBegin(LAN_LOGOFF);
+  lanSend();
+  session = Z21_SESSION_OFFLINE;
+  bc_flags = 0;
+}
+
+z21client_session_t z21Client_getSession(void)
+{
+  return session;
+}
+
+uint32_t z21Client_getPollInterval(void)
+{
+  return poll_interval;
+}
+
+uint32_t z21Client_getPollCount(void)
+{
+  return poll_count;
+}
+
+/* A datagram may hold several LAN messages back to back. They are parsed in
+ * place, each one bounded by its length field and the datagram size, the walk
+ * stops at the first message which does not fit. Returns the messages parsed. */
+uint16_t z21Client_parseReceived(const uint8_t* packet, uint16_t size)
+{
+  uint16_t count = 0;
+
+  while (size >= LAN_HEADER_LEN) {
+    uint16_t len = packet[0] | (packet[1]<<8);
+    uint16_t header = packet[2] | (packet[3]<<8);
+
+    if ((len < LAN_HEADER_LEN) || (len > size)) break;
+    switch (header) {
+    case LAN_X_Header:
+      ParseXNetMsg(packet + LAN_HEADER_LEN, len - LAN_HEADER_LEN);
+      break;
+    case LAN_GET_BROADCASTFLAGS:
+      if (len >= LAN_HEADER_LEN + 4)
+        bc_flags = packet[4] | (packet[5]<<8) | ((uint32_t)packet[6]<<16) | ((uint32_t)packet[7]<<24);
+      if ((session == Z21_SESSION_LOGIN) && (bc_flags & Z21_BC_ALL)) session = Z21_SESSION_ONLINE;
+      break;
+    }
+    count++;
+    packet += len;
+    size -= len;
+  }
+  if (count) last_rx = z21_now;
+  return count;
+}
+
 void z21Client_setSendDataCallback(dataCallback_t callback)
 {
   mSendDataCallback = callback;
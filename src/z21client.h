@@ -57,6 +57,20 @@ extern "C" {
 #define LAN_X_CV_POM_IO              0x30
 #define LAN_X_GET_STATUS             0x21
 
+// LAN_SET_BROADCASTFLAGS
+#define Z21_BC_NONE         0x00000000
+#define Z21_BC_ALL          0x00000001
+#define Z21_BC_RBUS         0x00000002
+#define Z21_BC_RAILCOM      0x00000004
+#define Z21_BC_SYSINFO      0x00000100
+#define Z21_BC_NETALL       0x00010000
+#define Z21_BC_LN           0x01000000
+#define Z21_BC_LN_LOCOS     0x02000000
+#define Z21_BC_LN_SWITCHES  0x04000000
+#define Z21_BC_LN_GBM       0x08000000
+#define Z21_BC_RAILCOM_ALL  0x00040000
+#define Z21_BC_CANDETECTOR  0x00080000
+
 // certain global Xpressnet status indicators
 #define CS_NORMAL         0x00 // Normal Operation Resumed
 #define CS_ESTOP          0x01 // Emergency stop
@@ -64,23 +78,80 @@ extern "C" {
 #define CS_TRACK_SHORTED  0x04 // Track short circuit
 #define CS_SERV_MODE      0x08 // Service Mode
 
-#define NUM_OF_LOCO_FUNC  29
+#define NUM_OF_LOCO_FUNC  32
+
+// LAN_X_LOCO_INFO content
+typedef struct
+{
+    uint16_t addr;
+    uint8_t steps;          // 14, 28 or 128
+    uint8_t speed;          // RVVVVVVV as received, R is the direction
+    bool busy;              // loco is controlled by another client
+    bool multi_unit;        // loco is part of a double traction
+    bool smart_search;
+    uint32_t func;          // F0-F31 states, bit n is Fn
+    uint32_t func_mask;     // functions present in the message, F29-F31 are optional
+} z21client_loco_info_t;
+
+// Commands tracked until the command station confirms them
+typedef enum
+{
+    Z21_CMD_SPEED,          // confirmed by LAN_X_LOCO_INFO
+    Z21_CMD_FUNC,           // confirmed by LAN_X_LOCO_INFO
+    Z21_CMD_TURNOUT,        // confirmed by LAN_X_TURNOUT_INFO
+    Z21_CMD_CV,             // confirmed by LAN_X_CV_RESULT or a CV NACK
+    Z21_CMD_NUM
+} z21client_cmd_t;
+
+typedef struct
+{
+    uint32_t sent;          // commands sent, retransmissions not included
+    uint32_t retries;       // retransmissions
+    uint32_t acked;         // commands confirmed by the expected response
+    uint32_t failed;        // commands given up after the last retransmission
+    uint32_t coalesced;     // commands replaced by a newer one before sending
+    uint16_t latency_last;  // ms from the first transmission to the response
+    uint16_t latency_max;
+    uint32_t latency_sum;   // latency_sum / acked is the average
+} z21client_cmd_stats_t;
+
+// Session with the command station
+typedef enum
+{
+    Z21_SESSION_OFFLINE,    // no link or logged off
+    Z21_SESSION_LOGIN,      // broadcast flags requested, not confirmed yet
+    Z21_SESSION_ONLINE,     // broadcasts subscribed, the state is pushed
+} z21client_session_t;
 
 typedef struct
 {
     void (*notifyXNetPower)(uint8_t status);
-    void (*notifyXNetExtControl)(uint16_t locoAddress);
+    void (*notifyXNetLocoInfo)(const z21client_loco_info_t *info);
+    void (*notifyXNetExtControl)(uint16_t locoAddress, bool busy);
     void (*notifyXNetExtSpeed)(uint16_t locoAddress, uint8_t steps, uint8_t value);
     void (*notifyXNetExtFunc)(uint16_t locoAddress, uint32_t funcMask, uint32_t funcStatus);
     void (*notifyXNetService)(bool directMode, uint16_t CV, uint8_t value);
     void (*notifyXNetServiceError)();
     void (*notifyXNetFeedback)(uint16_t address, uint8_t stateMask, uint8_t state);
 } z21client_callback_t;
-typedef void (*dataCallback_t)(uint8_t *data, uint8_t len);
+typedef void (*dataCallback_t)(uint8_t *data, uint16_t len);
 
 void z21Client_setSendDataCallback(dataCallback_t callback);
 void z21Client_setEventCallbacks(z21client_callback_t callback);
-void z21Client_parseReceived(uint8_t* packet, uint8_t size);
+uint16_t z21Client_parseReceived(const uint8_t* packet, uint16_t size);
+void z21Client_process(uint32_t now);
+void z21Client_getCmdStats(z21client_cmd_t type, z21client_cmd_stats_t *stats);
+void z21Client_beginBatch(void);
+bool z21Client_flushBatch(void);
+bool z21Client_setBroadcastFlags(uint32_t flags);
+uint32_t z21Client_getBroadcastFlags(void);
+bool z21Client_subscribeLoco(uint16_t locoAddress);
+void z21Client_sessionTick(bool linkUp);
+void z21Client_logoff(void);
+z21client_session_t z21Client_getSession(void);
+uint32_t z21Client_getPollInterval(void);
+uint32_t z21Client_getPollCount(void);
+bool z21Client_decodeLocoInfo(const uint8_t *XNetMsg, uint16_t len, z21client_loco_info_t *info);
 
 bool z21Client_requestStatus(void);
 bool z21Client_setPower(uint8_t power);
@@ -88,6 +159,8 @@ bool z21Client_setCV(uint16_t cv, uint8_t value);
 bool z21Client_setPoMCV(uint16_t address, uint16_t cv, uint8_t value);
 bool z21Client_requestReadCV(uint16_t address);
 bool z21Client_setTrntPos(uint16_t address, bool state, bool active);
+bool z21Client_requestTrntInfo(uint16_t address);
+bool z21Client_getTrntPos(uint16_t address, bool *state);
 bool z21Client_setSpeed(uint16_t locoAddress, uint8_t steps, uint8_t speed);
 bool z21Client_setLocoFunc(uint16_t locoAddress, uint8_t num, uint32_t funcStates);
 